@@ -4,6 +4,24 @@ newoption {
 newoption {
    trigger = 'without-generate',
    description = 'Do not generate a build configuration for the \'generate\' app'}
+newoption {
+   trigger = 'with-encoder',
+   description = 'Link the \'generate\' app and libhummingbird with libavcodec and libx264 to encode MP4 files in-process'}
+newoption {
+   trigger = 'without-extract',
+   description = 'Do not generate a build configuration for the \'extract\' app'}
+newoption {
+   trigger = 'without-stack-rotate-interleave',
+   description = 'Do not generate a build configuration for the \'stack_rotate_interleave\' app'}
+newoption {
+   trigger = 'without-benchmark',
+   description = 'Do not generate a build configuration for the \'benchmark\' app'}
+newoption {
+   trigger = 'without-library',
+   description = 'Do not generate a build configuration for the \'hummingbird\' shared library'}
+newoption {
+   trigger = 'without-prerender',
+   description = 'Do not generate a build configuration for the \'prerender\' app'}
 newoption {
    trigger = 'without-play',
    description = 'Do not generate a build configuration for the \'play\' app'}
@@ -15,9 +33,143 @@ solution 'hummingbird'
             kind 'ConsoleApp'
             language 'C++'
             location 'build'
-            files {'source/deinterleave.hpp', 'source/generate.cpp'}
+            files {
+                'source/bitplanes.hpp',
+                'source/device.hpp',
+                'source/instruction_set.hpp',
+                'source/io.hpp',
+                'source/deinterleave.hpp',
+                'source/incremental_deinterleave.hpp',
+                'source/live_ring.hpp',
+                'source/sparse_deinterleave.hpp',
+                'source/generate.cpp'}
+            buildoptions {'-std=c++11'}
+            linkoptions {'-std=c++11'}
+            links {'pthread'}
+            if _OPTIONS['with-encoder'] ~= nil then
+                files {'source/chunked_encode.hpp', 'source/encoder.hpp'}
+                defines {'HUMMINGBIRD_ENCODER'}
+                for path in string.gmatch(
+                    io.popen('pkg-config --cflags-only-I libavcodec libavformat libavutil'):read('*all'),
+                    "-I([^%s]+)") do
+                    includedirs(path)
+                end
+                linkoptions(io.popen('pkg-config --libs libavcodec libavformat libavutil'):read('*all'))
+            end
+            configuration 'release'
+                targetdir 'build/release'
+                defines {'NDEBUG'}
+                flags {'OptimizeSpeed'}
+            configuration 'debug'
+                targetdir 'build/debug'
+                defines {'DEBUG'}
+                flags {'Symbols'}
+            configuration 'linux'
+                links {'rt'}
+    end
+    if _OPTIONS['without-extract'] == nil then
+        project 'extract'
+            kind 'ConsoleApp'
+            language 'C++'
+            location 'build'
+            files {
+                'source/device.hpp',
+                'source/instruction_set.hpp',
+                'source/io.hpp',
+                'source/deinterleave.hpp',
+                'source/extract.hpp',
+                'source/extract.cpp'}
             buildoptions {'-std=c++11'}
             linkoptions {'-std=c++11'}
+            links {'pthread'}
+            configuration 'release'
+                targetdir 'build/release'
+                defines {'NDEBUG'}
+                flags {'OptimizeSpeed'}
+            configuration 'debug'
+                targetdir 'build/debug'
+                defines {'DEBUG'}
+                flags {'Symbols'}
+    end
+    if _OPTIONS['without-stack-rotate-interleave'] == nil then
+        project 'stack_rotate_interleave'
+            kind 'ConsoleApp'
+            language 'C++'
+            location 'build'
+            files {
+                'source/device.hpp',
+                'source/instruction_set.hpp',
+                'source/io.hpp',
+                'source/deinterleave.hpp',
+                'source/rotate.hpp',
+                'source/rotate_deinterleave.hpp',
+                'source/stack_rotate_interleave.cpp'}
+            buildoptions {'-std=c++11'}
+            linkoptions {'-std=c++11'}
+            links {'pthread'}
+            configuration 'release'
+                targetdir 'build/release'
+                defines {'NDEBUG'}
+                flags {'OptimizeSpeed'}
+            configuration 'debug'
+                targetdir 'build/debug'
+                defines {'DEBUG'}
+                flags {'Symbols'}
+    end
+    if _OPTIONS['without-benchmark'] == nil then
+        project 'benchmark'
+            kind 'ConsoleApp'
+            language 'C++'
+            location 'build'
+            files {
+                'source/bitplanes.hpp',
+                'source/device.hpp',
+                'source/instruction_set.hpp',
+                'source/io.hpp',
+                'source/deinterleave.hpp',
+                'source/extract.hpp',
+                'source/interleave.hpp',
+                'source/rotate.hpp',
+                'source/rotate_deinterleave.hpp',
+                'source/benchmark.cpp'}
+            buildoptions {'-std=c++11'}
+            linkoptions {'-std=c++11'}
+            links {'pthread'}
+            configuration 'release'
+                targetdir 'build/release'
+                defines {'NDEBUG'}
+                flags {'OptimizeSpeed'}
+            configuration 'debug'
+                targetdir 'build/debug'
+                defines {'DEBUG'}
+                flags {'Symbols'}
+    end
+    if _OPTIONS['without-library'] == nil then
+        project 'hummingbird'
+            kind 'SharedLib'
+            language 'C++'
+            location 'build'
+            files {
+                'source/device.hpp',
+                'source/instruction_set.hpp',
+                'source/deinterleave.hpp',
+                'source/deinterleaver.hpp',
+                'source/rotate.hpp',
+                'source/psychopy.hpp',
+                'source/hummingbird.h',
+                'source/hummingbird.cpp'}
+            buildoptions {'-std=c++11'}
+            linkoptions {'-std=c++11'}
+            if _OPTIONS['with-encoder'] ~= nil then
+                files {'source/encoder.hpp'}
+                defines {'HUMMINGBIRD_ENCODER'}
+                for path in string.gmatch(
+                    io.popen('pkg-config --cflags-only-I libavcodec libavformat libavutil'):read('*all'),
+                    "-I([^%s]+)") do
+                    includedirs(path)
+                end
+                linkoptions(io.popen('pkg-config --libs libavcodec libavformat libavutil'):read('*all'))
+            end
             configuration 'release'
                 targetdir 'build/release'
                 defines {'NDEBUG'}
@@ -32,7 +184,7 @@ solution 'hummingbird'
             kind 'ConsoleApp'
             language 'C++'
             location 'build'
-            files {'source/lightcrafter.hpp', 'source/change_lightcrafter_ip.cpp'}
+            files {'source/device.hpp', 'source/lightcrafter.hpp', 'source/change_lightcrafter_ip.cpp'}
             buildoptions {'-std=c++11'}
             linkoptions {'-std=c++11'}
             configuration 'release'
@@ -50,9 +202,17 @@ solution 'hummingbird'
             language 'C++'
             location 'build'
             files {
+                'source/bitplanes.hpp',
                 'source/decoder.hpp',
+                'source/device.hpp',
                 'source/display.hpp',
+                'source/frame_cache.hpp',
+                'source/frame_pool.hpp',
+                'source/frame_store.hpp',
+                'source/instruction_set.hpp',
+                'source/keyframe_index.hpp',
                 'source/lightcrafter.hpp',
+                'source/live_ring.hpp',
                 'source/interleave.hpp',
                 'source/play.cpp',
                 'third_party/glad/src/glad.cpp'}
@@ -74,9 +234,40 @@ solution 'hummingbird'
                 defines {'DEBUG'}
                 flags {'Symbols'}
             configuration 'linux'
-                links {'GL', 'pthread'}
+                links {'GL', 'pthread', 'rt'}
             configuration 'macosx'
                 includedirs {'/usr/local/include'}
                 libdirs {'/usr/local/lib'}
                 links {'OpenGL.framework'}
     end
+    if _OPTIONS['without-prerender'] == nil then
+        project 'prerender'
+            kind 'ConsoleApp'
+            language 'C++'
+            location 'build'
+            files {
+                'source/decoder.hpp',
+                'source/device.hpp',
+                'source/frame_store.hpp',
+                'source/instruction_set.hpp',
+                'source/interleave.hpp',
+                'source/keyframe_index.hpp',
+                'source/prerender.cpp'}
+            buildoptions {'-std=c++11'}
+            linkoptions {'-std=c++11'}
+            for path in string.gmatch(
+                io.popen('pkg-config --cflags-only-I gstreamermm-1.0'):read('*all'),
+                "-I([^%s]+)") do
+                includedirs(path)
+            end
+            linkoptions(io.popen('pkg-config --cflags --libs gstreamermm-1.0'):read('*all'))
+            links {'pthread'}
+            configuration 'release'
+                targetdir 'build/release'
+                defines {'NDEBUG'}
+                flags {'OptimizeSpeed'}
+            configuration 'debug'
+                targetdir 'build/debug'
+                defines {'DEBUG'}
+                flags {'Symbols'}
+    end
@@ -1,7 +1,9 @@
-import math
+import ctypes
+import os
 import PIL.Image
 import numpy
 import subprocess
+import sys
 
 # size contains the display's width and height in pixels.
 size = (343, 342) # pixels
@@ -9,74 +11,162 @@ size = (343, 342) # pixels
 # maximum_framerate is the largest number of frames per second the LightCrafter can handle.
 maximum_framerate = 1440
 
+# lightcrafter_size contains the LightCrafter's width and height in pixels.
+lightcrafter_size = (608, 684) # pixels
+
+def load_library():
+    """
+    load_library returns the native Hummingbird library (libhummingbird), or None if it cannot be found
+    the library is searched in the HUMMINGBIRD_LIBRARY environment variable, next to this file,
+    and in the build directory of the C++ apps
+    """
+    name = 'libhummingbird.dylib' if sys.platform == 'darwin' else 'libhummingbird.so'
+    directory = os.path.dirname(os.path.abspath(__file__))
+    if 'HUMMINGBIRD_LIBRARY' in os.environ:
+        candidates = [os.environ['HUMMINGBIRD_LIBRARY']]
+    else:
+        candidates = [os.path.join(directory, name), os.path.join(directory, '..', 'build', 'release', name)]
+    for candidate in candidates:
+        if os.path.isfile(candidate):
+            library = ctypes.CDLL(candidate)
+            library.hummingbird_last_error.argtypes = []
+            library.hummingbird_last_error.restype = ctypes.c_char_p
+            library.hummingbird_frame_size.argtypes = []
+            library.hummingbird_frame_size.restype = ctypes.c_size_t
+            library.hummingbird_psychopy_insert.argtypes = [ctypes.c_void_p, ctypes.c_size_t, ctypes.c_void_p, ctypes.c_size_t]
+            library.hummingbird_psychopy_insert.restype = ctypes.c_int
+            library.hummingbird_psychopy_fill_corner.argtypes = [ctypes.c_void_p, ctypes.c_size_t, ctypes.c_uint8, ctypes.c_size_t]
+            library.hummingbird_psychopy_fill_corner.restype = ctypes.c_int
+            library.hummingbird_has_encoder.argtypes = []
+            library.hummingbird_has_encoder.restype = ctypes.c_int
+            library.hummingbird_encoder_open.argtypes = [ctypes.c_char_p, ctypes.c_char_p]
+            library.hummingbird_encoder_open.restype = ctypes.c_void_p
+            library.hummingbird_encoder_write.argtypes = [ctypes.c_void_p, ctypes.c_void_p]
+            library.hummingbird_encoder_write.restype = ctypes.c_int
+            library.hummingbird_encoder_close.argtypes = [ctypes.c_void_p]
+            library.hummingbird_encoder_close.restype = ctypes.c_int
+            return library
+    return None
+
+# library is the native Hummingbird library, or None if it was not found (Generator then uses numpy).
+library = load_library()
+
+def check(result):
+    """check raises the last native error if result is -1"""
+    if result == -1:
+        raise RuntimeError(library.hummingbird_last_error().decode())
+
+# rows and columns map each display pixel to its LightCrafter pixel (diamond pixel arrangement).
+rows = numpy.fromfunction(lambda y, x: size[1] - x + y, (size[1], size[0]), dtype=numpy.intp)
+columns = numpy.fromfunction(
+    lambda y, x: (lightcrafter_size[0] - size[1]) // 2 + (x + y) // 2, (size[1], size[0]), dtype=numpy.intp)
+
 class Generator:
     """
     Generator creates a LightCrafter-compatible video from binary frames
     synchronization_pattern must be a list or tuple of bytes
+    if native_encoder is True, frames are encoded in-process by the native library instead of ffmpeg
     """
-    def __init__(self, filename, synchronization_pattern=(), corner_size=10, framerate=maximum_framerate, ffmpeg='ffmpeg'):
+    def __init__(self, filename, synchronization_pattern=(), corner_size=10, framerate=maximum_framerate, ffmpeg='ffmpeg', native_encoder=False):
         assert maximum_framerate % framerate == 0, 'the framerate must divide the maximum framerate ({} fps)'.format(maximum_framerate)
         self.replicates = int(maximum_framerate / framerate)
-        self.process = subprocess.Popen(
-            'ffmpeg -y -i pipe: -c:v libx264 -preset veryslow -pix_fmt yuv420p -crf 0 {}'.format(filename),
-            stdin=subprocess.PIPE,
-            stdout=subprocess.PIPE,
-            stderr=subprocess.PIPE,
-            shell=True)
-        self.process.stdin.write(b'YUV4MPEG2 W1216 H684 F60:1 Ip C420\n')
+        self.process = None
+        self.encoder = None
+        if native_encoder:
+            if library is None or library.hummingbird_has_encoder() == 0:
+                raise RuntimeError('native_encoder requires libhummingbird built with the encoder')
+            self.encoder = library.hummingbird_encoder_open(filename.encode(), b'veryslow')
+            if self.encoder is None:
+                raise RuntimeError(library.hummingbird_last_error().decode())
+        else:
+            self.process = subprocess.Popen(
+                '{} -y -i pipe: -c:v libx264 -preset veryslow -pix_fmt yuv420p -crf 0 {}'.format(ffmpeg, filename),
+                stdin=subprocess.PIPE,
+                stdout=subprocess.PIPE,
+                stderr=subprocess.PIPE,
+                shell=True)
+            self.process.stdin.write(b'YUV4MPEG2 W1216 H684 F60:1 Ip C420\n')
         self.synchronization_pattern = synchronization_pattern
         self.corner_size = corner_size
         self.synchronization_pattern_index = 0
         self.index = 0
+        self.frame = numpy.zeros(lightcrafter_size[0] * lightcrafter_size[1] * 3, dtype=numpy.uint8)
         self.frames = [
             numpy.empty((size[1], size[0]), dtype=numpy.uint8),
             numpy.empty((size[1], size[0]), dtype=numpy.uint8),
             numpy.empty((size[1], size[0]), dtype=numpy.uint8)]
     def push_frame(self, frame):
-        """push_frame adds a binary frame to the output"""
-        return_code = self.process.poll()
-        if return_code == None:
+        """
+        push_frame adds a binary frame to the output
+        frame can be a PIL image or a 342 x 343 numpy array (uint8 or bool)
+        """
+        if self.process is not None:
+            return_code = self.process.poll()
+            if return_code != None:
+                raise RuntimeError('ffmpeg returned with the error {}\nstdout: {}\nsterr: {}'.format(
+                    return_code,
+                    self.process.stdout.read(),
+                    self.process.stderr.read()))
+        if isinstance(frame, numpy.ndarray):
+            assert frame.shape == (size[1], size[0]), 'numpy frames must have the shape {}'.format((size[1], size[0]))
+            greys = numpy.ascontiguousarray(numpy.where(frame, 255, 0) if frame.dtype == numpy.bool_ else frame, dtype=numpy.uint8)
+        else:
             if frame.size == (size[0] * 2, size[1] * 2):
                 frame = frame.resize(size, resample=PIL.Image.BOX)
-            for replicate_index in range(0, self.replicates):
+            greys = numpy.ascontiguousarray(numpy.asarray(frame.convert(mode='L')), dtype=numpy.uint8)
+        for replicate_index in range(0, self.replicates):
+            if library is None:
                 channel = (int(self.index / 8) + 2) % 3
                 mask = (1 << (self.index % 8))
-                binary_frame = numpy.where(numpy.asarray(frame.convert(mode='L')) > 127, mask, 0).astype(numpy.uint8)
+                binary_frame = numpy.where(greys > 127, mask, 0).astype(numpy.uint8)
                 self.frames[channel] &= (0b11111111 ^ mask)
-                self.frames[channel] = numpy.bitwise_or(self.frames[channel], binary_frame, dtype=numpy.uint8)
-                if self.index == 23:
-                    lightcrafter_frames = []
-                    for local_frame in self.frames:
-                        lightcrafter_frame = numpy.zeros((684, 608), dtype=numpy.uint8)
-                        for y in range(0, size[1]):
-                            for x in range(0, size[0]):
-                                lightcrafter_frame[342 - x + y, 133 + int((x + y) / 2)] = local_frame[y, x]
-                        if self.synchronization_pattern_index < len(self.synchronization_pattern):
-                            for y in range(0, self.corner_size * 2):
-                                for x in range(608 - (self.corner_size + 1 - int((y + 1) / 2)), 608):
-                                    lightcrafter_frame[y, x] = self.synchronization_pattern[self.synchronization_pattern_index]
-                            self.synchronization_pattern_index += 1
-                        lightcrafter_frames.append(lightcrafter_frame)
-                    self.process.stdin.write(b'FRAME\n')
-                    self.process.stdin.write(
-                        numpy
-                            .vstack((lightcrafter_frames[0].flatten(), lightcrafter_frames[1].flatten()))
-                            .reshape((-1, ), order='F')
-                            .astype(numpy.uint8)
-                            .tobytes())
-                    self.process.stdin.write(lightcrafter_frames[2][::2].astype(numpy.uint8).tobytes())
-                    self.process.stdin.write(lightcrafter_frames[2][1::2].astype(numpy.uint8).tobytes())
-                    self.process.stdin.flush()
-                    self.index = 0
+                self.frames[channel] |= binary_frame
+            else:
+                check(library.hummingbird_psychopy_insert(
+                    greys.ctypes.data, greys.strides[0], self.frame.ctypes.data, self.index))
+            if self.index == 23:
+                self.write_frame()
+                self.index = 0
+            else:
+                self.index += 1
+    def write_frame(self):
+        """write_frame packs the pending patterns and sends them to the encoder"""
+        if library is None:
+            lightcrafter_frames = []
+            for local_frame in self.frames:
+                lightcrafter_frame = numpy.zeros((lightcrafter_size[1], lightcrafter_size[0]), dtype=numpy.uint8)
+                lightcrafter_frame[rows, columns] = local_frame
+                if self.synchronization_pattern_index < len(self.synchronization_pattern):
+                    for y in range(0, self.corner_size * 2):
+                        lightcrafter_frame[y, lightcrafter_size[0] - (self.corner_size + 1 - int((y + 1) / 2)):] = self.synchronization_pattern[self.synchronization_pattern_index]
+                    self.synchronization_pattern_index += 1
+                lightcrafter_frames.append(lightcrafter_frame)
+            pixels = lightcrafter_size[0] * lightcrafter_size[1]
+            self.frame[0:pixels * 2:2] = lightcrafter_frames[0].reshape((-1, ))
+            self.frame[1:pixels * 2:2] = lightcrafter_frames[1].reshape((-1, ))
+            self.frame[pixels * 2:pixels * 5 // 2] = lightcrafter_frames[2][::2].reshape((-1, ))
+            self.frame[pixels * 5 // 2:] = lightcrafter_frames[2][1::2].reshape((-1, ))
+        else:
+            for channel in range(0, 3):
+                if self.synchronization_pattern_index < len(self.synchronization_pattern):
+                    value = self.synchronization_pattern[self.synchronization_pattern_index]
+                    self.synchronization_pattern_index += 1
                 else:
-                    self.index += 1
+                    value = 0
+                check(library.hummingbird_psychopy_fill_corner(self.frame.ctypes.data, channel, value, self.corner_size))
+        if self.encoder is None:
+            self.process.stdin.write(b'FRAME\n')
+            self.process.stdin.write(self.frame.data)
+            self.process.stdin.flush()
         else:
-            raise RuntimeError('ffmpeg returned with the error {}\nstdout: {}\nsterr: {}'.format(
-                return_code,
-                self.process.stdout.read(),
-                self.process.stderr.read()))
+            check(library.hummingbird_encoder_write(self.encoder, self.frame.ctypes.data))
     def close(self):
-        self.process.stdin.close()
+        if self.encoder is None:
+            self.process.stdin.close()
+        else:
+            encoder = self.encoder
+            self.encoder = None
+            check(library.hummingbird_encoder_close(encoder))
     def __enter__(self):
         return self
     def __exit__(self, type, value, traceback):
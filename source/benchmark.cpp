@@ -0,0 +1,351 @@
+#include "../third_party/pontella/source/pontella.hpp"
+#include "bitplanes.hpp"
+#include "extract.hpp"
+#include "interleave.hpp"
+#include "rotate_deinterleave.hpp"
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/// stimulus enumerates the synthetic patterns used to benchmark the kernels.
+enum class stimulus {
+    all_off,
+    all_on,
+    random,
+    sparse_dots,
+};
+
+/// stimulus_name returns the name of a stimulus.
+const char* stimulus_name(stimulus pattern) {
+    switch (pattern) {
+        case stimulus::all_off:
+            return "all-off";
+        case stimulus::all_on:
+            return "all-on";
+        case stimulus::random:
+            return "random";
+        case stimulus::sparse_dots:
+            return "sparse-dots";
+    }
+    return "unknown";
+}
+
+/// make_patterns generates count raw patterns with the given number of pixels.
+/// Bit patterns are packed continuously (least significant bit first) and padded to a whole byte.
+/// Sparse dots turn on one pixel in a hundred.
+std::vector<uint8_t> make_patterns(stimulus pattern, std::size_t pixels, bool bit_input, std::size_t count) {
+    const std::size_t pattern_size = bit_input ? (pixels + 7) / 8 : pixels;
+    std::vector<uint8_t> bytes(pattern_size * count, 0);
+    std::mt19937 engine(42);
+    std::uniform_int_distribution<std::size_t> percent(0, 99);
+    for (std::size_t index = 0; index < count; ++index) {
+        auto pattern_bytes = bytes.data() + index * pattern_size;
+        for (std::size_t pixel = 0; pixel < pixels; ++pixel) {
+            bool on = false;
+            switch (pattern) {
+                case stimulus::all_off:
+                    break;
+                case stimulus::all_on:
+                    on = true;
+                    break;
+                case stimulus::random:
+                    on = percent(engine) < 50;
+                    break;
+                case stimulus::sparse_dots:
+                    on = percent(engine) == 0;
+                    break;
+            }
+            if (on) {
+                if (bit_input) {
+                    pattern_bytes[pixel / 8] |= static_cast<uint8_t>(1 << (pixel % 8));
+                } else {
+                    pattern_bytes[pixel] = 0xff;
+                }
+            }
+        }
+    }
+    return bytes;
+}
+
+/// measurement holds the result of a kernel benchmark.
+struct measurement {
+    /// frames is the number of 60 Hz frames processed.
+    std::size_t frames;
+
+    /// duration is the elapsed time in seconds.
+    double duration;
+
+    /// cycles is the number of elapsed timestamp counter cycles, 0 if the counter is not available.
+    uint64_t cycles;
+};
+
+/// cycle_counter returns the processor's timestamp counter, or 0 if it is not available.
+inline uint64_t cycle_counter() {
+#if defined(HUMMINGBIRD_X86)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/// measure calls kernel until at least duration seconds have elapsed, after a warm-up call.
+/// kernel processes one 60 Hz frame per call.
+measurement measure(double duration, const std::function<void()>& kernel) {
+    kernel();
+    measurement result{0, 0.0, 0};
+    const auto begin = std::chrono::steady_clock::now();
+    const auto begin_cycles = cycle_counter();
+    do {
+        kernel();
+        ++result.frames;
+        result.duration =
+            std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - begin)
+                .count();
+    } while (result.duration < duration);
+    result.cycles = cycle_counter() - begin_cycles;
+    return result;
+}
+
+/// benchmark runs a kernel, prints a report line and returns false if the kernel is gated and slower than
+/// minimum_ratio times real time (60 frames per second). Kernels which are not gated are reported without failing.
+/// bytes_per_frame and pixels_per_frame are the input bytes and pixels processed by each call.
+bool benchmark(
+    const std::string& kernel_name,
+    const std::string& set_name,
+    stimulus pattern,
+    double duration,
+    double minimum_ratio,
+    bool gated,
+    std::size_t bytes_per_frame,
+    std::size_t pixels_per_frame,
+    const std::function<void()>& kernel) {
+    const auto result = measure(duration, kernel);
+    const auto frames_per_second = result.frames / result.duration;
+    const auto ratio = frames_per_second / 60.0;
+    const auto gigabytes_per_second = frames_per_second * bytes_per_frame / 1e9;
+    char line[256];
+    if (result.cycles > 0) {
+        std::snprintf(
+            line,
+            sizeof(line),
+            "%-12s %-7s %-12s %12.1f %10.2fx %9.3f %14.3f",
+            kernel_name.c_str(),
+            set_name.c_str(),
+            stimulus_name(pattern),
+            frames_per_second,
+            ratio,
+            gigabytes_per_second,
+            static_cast<double>(result.cycles) / (static_cast<double>(result.frames) * pixels_per_frame));
+    } else {
+        std::snprintf(
+            line,
+            sizeof(line),
+            "%-12s %-7s %-12s %12.1f %10.2fx %9.3f %14s",
+            kernel_name.c_str(),
+            set_name.c_str(),
+            stimulus_name(pattern),
+            frames_per_second,
+            ratio,
+            gigabytes_per_second,
+            "-");
+    }
+    const auto real_time = ratio >= minimum_ratio;
+    std::cout << line << (real_time ? "" : (gated ? "  SLOW" : "  slow (not gated)")) << std::endl;
+    return real_time || !gated;
+}
+
+int main(int argc, char* argv[]) {
+    return pontella::main(
+        {
+            "benchmark measures the throughput of the packing, unpacking, extraction and bit-plane decoding kernels",
+            "    each kernel processes synthetic patterns (all-off, all-on, random and sparse dots)",
+            "    with every instruction set supported by the processor, without a display or a decoder",
+            "    a kernel is flagged as SLOW if it processes less than 'ratio' times 60 frames per second",
+            "    (1440 patterns per second for the packing kernels), and the app then exits with an error",
+            "    only the instruction set dispatched at runtime is gated, the other sets are reported",
+            "    (and marked as slow) without failing",
+            "Syntax: ./benchmark [options]",
+            "Available options",
+            "    -d [seconds], --duration [seconds]    sets the duration of each measurement",
+            "                                              defaults to 0.5",
+            "    -r [ratio], --ratio [ratio]           sets the minimum multiple of the real-time rate",
+            "                                              defaults to 2",
+            "    -h, --help                            shows this help message",
+        },
+        argc,
+        argv,
+        0,
+        {
+            {"duration", {"d"}},
+            {"ratio", {"r"}},
+        },
+        {},
+        [](pontella::command command) {
+            using device = hummingbird::lightcrafter_1440_hz;
+            using diamond = hummingbird::diamond<device>;
+            double duration = 0.5;
+            {
+                const auto name_and_value = command.options.find("duration");
+                if (name_and_value != command.options.end()) {
+                    duration = std::stod(name_and_value->second);
+                    if (duration <= 0.0) {
+                        throw std::runtime_error("the duration must be larger than 0");
+                    }
+                }
+            }
+            double ratio = 2.0;
+            {
+                const auto name_and_value = command.options.find("ratio");
+                if (name_and_value != command.options.end()) {
+                    ratio = std::stod(name_and_value->second);
+                }
+            }
+            const auto sets = hummingbird::supported_instruction_sets();
+            const auto dispatched = hummingbird::detect_instruction_set();
+            // kernels without an implementation for a set run the implementation of a smaller set (see
+            // instruction_set), hence each kernel is reported with the sets it implements only, and gated with the set
+            // which runs when dispatched: the interleave kernel has no SSE2 implementation (the scalar one runs), and
+            // the other kernels have no SSSE3 implementation (the SSE2 one runs)
+            const auto without = [&](hummingbird::instruction_set missing) {
+                std::vector<hummingbird::instruction_set> result;
+                for (const auto set : sets) {
+                    if (set != missing) {
+                        result.push_back(set);
+                    }
+                }
+                return result;
+            };
+            const auto kernel_sets = without(hummingbird::instruction_set::ssse3);
+            const auto kernel_dispatched =
+                dispatched == hummingbird::instruction_set::ssse3 ? hummingbird::instruction_set::sse2 : dispatched;
+            const auto interleave_sets = without(hummingbird::instruction_set::sse2);
+            const auto interleave_dispatched =
+                dispatched == hummingbird::instruction_set::sse2 ? hummingbird::instruction_set::scalar : dispatched;
+            const std::vector<stimulus> patterns{
+                stimulus::all_off, stimulus::all_on, stimulus::random, stimulus::sparse_dots};
+            std::cout << "kernel       set     stimulus         frames/s  real-time      GB/s   cycles/pixel"
+                      << std::endl;
+            std::size_t slow_kernels = 0;
+            std::vector<uint8_t> frame(device::frame_size);
+            std::vector<uint8_t> rgbs(device::frame_size);
+            for (const auto pattern : patterns) {
+                for (const auto bit_input : {true, false}) {
+                    const auto bytes = make_patterns(pattern, device::pixels, bit_input, device::patterns_per_frame);
+                    for (const auto set : kernel_sets) {
+                        if (!benchmark(
+                                bit_input ? "bit" : "grey",
+                                hummingbird::instruction_set_name(set),
+                                pattern,
+                                duration,
+                                ratio,
+                                set == kernel_dispatched,
+                                bytes.size(),
+                                device::pixels * device::patterns_per_frame,
+                                [&]() {
+                                    hummingbird::deinterleave_group<device>(
+                                        set, bit_input, bytes.data(), frame.data());
+                                })) {
+                            ++slow_kernels;
+                        }
+                    }
+                }
+                for (const auto bit_input : {true, false}) {
+                    const auto bytes = make_patterns(pattern, diamond::pixels, bit_input, device::patterns_per_frame);
+                    for (const auto set : kernel_sets) {
+                        if (!benchmark(
+                                bit_input ? "rotate bit" : "rotate grey",
+                                hummingbird::instruction_set_name(set),
+                                pattern,
+                                duration,
+                                ratio,
+                                set == kernel_dispatched,
+                                bytes.size(),
+                                diamond::pixels * device::patterns_per_frame,
+                                [&]() {
+                                    hummingbird::rotate_deinterleave_group<device>(
+                                        set, bit_input, bytes.data(), frame.data());
+                                })) {
+                            ++slow_kernels;
+                        }
+                    }
+                }
+                for (const auto bit_output : {true, false}) {
+                    auto bytes = make_patterns(pattern, device::pixels, bit_output, device::patterns_per_frame);
+                    hummingbird::deinterleave_group<device>(
+                        hummingbird::detect_instruction_set(), bit_output, bytes.data(), frame.data());
+                    for (const auto set : kernel_sets) {
+                        if (!benchmark(
+                                bit_output ? "extract bit" : "extract grey",
+                                hummingbird::instruction_set_name(set),
+                                pattern,
+                                duration,
+                                ratio,
+                                set == kernel_dispatched,
+                                frame.size(),
+                                device::pixels * device::patterns_per_frame,
+                                [&]() {
+                                    hummingbird::extract_group<device>(set, bit_output, frame.data(), bytes.data());
+                                })) {
+                            ++slow_kernels;
+                        }
+                    }
+                }
+                {
+                    const auto bytes = make_patterns(pattern, device::pixels, true, device::patterns_per_frame);
+                    hummingbird::deinterleave_group<device>(
+                        hummingbird::detect_instruction_set(), true, bytes.data(), frame.data());
+                    for (const auto set : interleave_sets) {
+                        if (!benchmark(
+                                "interleave",
+                                hummingbird::instruction_set_name(set),
+                                pattern,
+                                duration,
+                                ratio,
+                                set == interleave_dispatched,
+                                frame.size(),
+                                device::pixels,
+                                [&]() { hummingbird::interleave<device>(set, frame.data(), rgbs.data()); })) {
+                            ++slow_kernels;
+                        }
+                    }
+                }
+                {
+                    const auto bytes = make_patterns(pattern, device::pixels, true, device::patterns_per_frame);
+                    hummingbird::deinterleave_group<device>(
+                        hummingbird::detect_instruction_set(), true, bytes.data(), frame.data());
+                    std::vector<uint32_t> table;
+                    std::vector<uint8_t> payload;
+                    hummingbird::bitplanes_encode(frame.data(), frame.size(), table, payload);
+                    std::vector<uint8_t> previous(frame.size(), 0);
+                    for (const auto set : kernel_sets) {
+                        if (!benchmark(
+                                "bitplanes",
+                                hummingbird::instruction_set_name(set),
+                                pattern,
+                                duration,
+                                ratio,
+                                set == kernel_dispatched,
+                                payload.size(),
+                                device::pixels,
+                                [&]() {
+                                    hummingbird::bitplanes_decode(
+                                        payload.data(), payload.size(), rgbs.data(), frame.size());
+                                    hummingbird::xor_bytes(set, previous.data(), rgbs.data(), frame.size());
+                                })) {
+                            ++slow_kernels;
+                        }
+                    }
+                }
+            }
+            if (slow_kernels > 0) {
+                char message[128];
+                std::snprintf(
+                    message, sizeof(message), "%zu kernel(s) are slower than %g times real time", slow_kernels, ratio);
+                throw std::runtime_error(message);
+            }
+        });
+}
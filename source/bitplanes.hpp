@@ -0,0 +1,644 @@
+#pragma once
+
+#include "instruction_set.hpp"
+#include "io.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <vector>
+
+/// hummingbird bundles tools to create and play high framerate videos.
+namespace hummingbird {
+    /// The bit-plane codec compresses packed YUV420 frames losslessly. Each byte of a packed frame holds 8 binary
+    /// patterns, hence a frame is either stored as is (key frame) or XORed with the previous frame (delta frame), and
+    /// binary stimuli produce long runs of identical bytes and rows repeated at a fixed distance.
+    /// The stored bytes are compressed with LZ77 sequences, in the spirit of LZ4:
+    ///     - a token byte, whose high nibble is the literal length and low nibble the match length minus 4,
+    ///     - if the literal nibble is 15, length extension bytes (255 continues, any other value ends),
+    ///     - literal bytes,
+    ///     - unless the frame ends after the literals, the match offset on 16 bits (little endian),
+    ///     - if the match nibble is 15, length extension bytes.
+    /// A match copies bytes already decoded offset bytes earlier (offset 1 encodes a run of a single value).
+    /// Decoding only copies bytes and XORs the result into the previous frame, which makes it memory-bound.
+
+    /// bitplanes_hash_bits is the base-2 logarithm of the number of entries in the encoder's match table.
+    const std::size_t bitplanes_hash_bits = 16;
+
+    /// bitplanes_minimum_match is the length of the shortest match.
+    const std::size_t bitplanes_minimum_match = 4;
+
+    /// bitplanes_maximum_offset is the largest distance between a match and its source.
+    const std::size_t bitplanes_maximum_offset = 65535;
+
+    /// xor_bytes_scalar XORs source into target.
+    inline void xor_bytes_scalar(uint8_t* target, const uint8_t* source, std::size_t size) {
+        std::size_t index = 0;
+        for (; index + 8 <= size; index += 8) {
+            uint64_t target_word;
+            uint64_t source_word;
+            std::memcpy(&target_word, target + index, sizeof(target_word));
+            std::memcpy(&source_word, source + index, sizeof(source_word));
+            target_word ^= source_word;
+            std::memcpy(target + index, &target_word, sizeof(target_word));
+        }
+        for (; index < size; ++index) {
+            target[index] ^= source[index];
+        }
+    }
+
+#if defined(HUMMINGBIRD_X86)
+    /// xor_bytes_sse2 is the SSE2 version of xor_bytes_scalar (16 bytes per iteration).
+    __attribute__((target("sse2"))) inline void
+    xor_bytes_sse2(uint8_t* target, const uint8_t* source, std::size_t size) {
+        std::size_t index = 0;
+        for (; index + 16 <= size; index += 16) {
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(target + index),
+                _mm_xor_si128(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(target + index)),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + index))));
+        }
+        xor_bytes_scalar(target + index, source + index, size - index);
+    }
+
+    /// xor_bytes_avx2 is the AVX2 version of xor_bytes_scalar (32 bytes per iteration).
+    __attribute__((target("avx2"))) inline void
+    xor_bytes_avx2(uint8_t* target, const uint8_t* source, std::size_t size) {
+        std::size_t index = 0;
+        for (; index + 32 <= size; index += 32) {
+            _mm256_storeu_si256(
+                reinterpret_cast<__m256i*>(target + index),
+                _mm256_xor_si256(
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(target + index)),
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + index))));
+        }
+        xor_bytes_scalar(target + index, source + index, size - index);
+    }
+#elif defined(HUMMINGBIRD_NEON)
+    /// xor_bytes_neon is the NEON version of xor_bytes_scalar (16 bytes per iteration).
+    inline void xor_bytes_neon(uint8_t* target, const uint8_t* source, std::size_t size) {
+        std::size_t index = 0;
+        for (; index + 16 <= size; index += 16) {
+            vst1q_u8(target + index, veorq_u8(vld1q_u8(target + index), vld1q_u8(source + index)));
+        }
+        xor_bytes_scalar(target + index, source + index, size - index);
+    }
+#endif
+
+    /// xor_bytes XORs source into target.
+    inline void xor_bytes(instruction_set set, uint8_t* target, const uint8_t* source, std::size_t size) {
+        switch (set) {
+#if defined(HUMMINGBIRD_X86)
+            case instruction_set::ssse3:
+            case instruction_set::sse2:
+                xor_bytes_sse2(target, source, size);
+                return;
+            case instruction_set::avx2:
+                xor_bytes_avx2(target, source, size);
+                return;
+#elif defined(HUMMINGBIRD_NEON)
+            case instruction_set::neon:
+                xor_bytes_neon(target, source, size);
+                return;
+#endif
+            default:
+                xor_bytes_scalar(target, source, size);
+        }
+    }
+
+    /// bitplanes_load reads 4 bytes as an integer.
+    inline uint32_t bitplanes_load(const uint8_t* bytes) {
+        uint32_t word;
+        std::memcpy(&word, bytes, sizeof(word));
+        return word;
+    }
+
+    /// bitplanes_match_length returns the number of identical bytes at source and target, with source < target.
+    inline std::size_t
+    bitplanes_match_length(const uint8_t* bytes, std::size_t source, std::size_t target, std::size_t size) {
+        const auto begin = target;
+        for (; target + 8 <= size; source += 8, target += 8) {
+            uint64_t source_word;
+            uint64_t target_word;
+            std::memcpy(&source_word, bytes + source, sizeof(source_word));
+            std::memcpy(&target_word, bytes + target, sizeof(target_word));
+            if (source_word != target_word) {
+                break;
+            }
+        }
+        for (; target < size && bytes[source] == bytes[target]; ++source, ++target) {
+        }
+        return target - begin;
+    }
+
+    /// bitplanes_write_length appends the extension bytes of a token length larger than or equal to 15.
+    inline void bitplanes_write_length(std::vector<uint8_t>& output, std::size_t length) {
+        length -= 15;
+        for (; length >= 255; length -= 255) {
+            output.push_back(255);
+        }
+        output.push_back(static_cast<uint8_t>(length));
+    }
+
+    /// bitplanes_write_sequence appends a token, literals and, if match is not zero, a match.
+    inline void bitplanes_write_sequence(
+        std::vector<uint8_t>& output,
+        const uint8_t* literals_begin,
+        std::size_t literals,
+        std::size_t offset,
+        std::size_t match) {
+        const auto match_nibble = match == 0 ? 0 : std::min(match - bitplanes_minimum_match, std::size_t(15));
+        output.push_back(static_cast<uint8_t>((std::min(literals, std::size_t(15)) << 4) | match_nibble));
+        if (literals >= 15) {
+            bitplanes_write_length(output, literals);
+        }
+        output.insert(output.end(), literals_begin, literals_begin + literals);
+        if (match > 0) {
+            output.push_back(static_cast<uint8_t>(offset & 0xff));
+            output.push_back(static_cast<uint8_t>(offset >> 8));
+            if (match_nibble == 15) {
+                bitplanes_write_length(output, match - bitplanes_minimum_match);
+            }
+        }
+    }
+
+    /// bitplanes_encode appends the sequences of bytes (a key frame or the XOR of a frame with the previous one) to
+    /// output. table is scratch memory for the match finder, reused across calls to avoid allocations.
+    inline void bitplanes_encode(
+        const uint8_t* bytes,
+        std::size_t size,
+        std::vector<uint32_t>& table,
+        std::vector<uint8_t>& output) {
+        table.assign(std::size_t(1) << bitplanes_hash_bits, 0);
+        std::size_t anchor = 0;
+        std::size_t position = 0;
+        while (position + bitplanes_minimum_match <= size) {
+            const auto word = bitplanes_load(bytes + position);
+            auto& entry = table[(word * 2654435761u) >> (32 - bitplanes_hash_bits)];
+            const auto candidate = static_cast<std::size_t>(entry);
+            entry = static_cast<uint32_t>(position + 1);
+            if (candidate > 0 && position + 1 - candidate <= bitplanes_maximum_offset
+                && bitplanes_load(bytes + candidate - 1) == word) {
+                const auto match = bitplanes_match_length(bytes, candidate - 1, position, size);
+                bitplanes_write_sequence(output, bytes + anchor, position - anchor, position + 1 - candidate, match);
+                position += match;
+                anchor = position;
+            } else {
+                ++position;
+            }
+        }
+        if (anchor < size) {
+            bitplanes_write_sequence(output, bytes + anchor, size - anchor, 0, 0);
+        }
+    }
+
+    /// bitplanes_read_length reads the extension bytes of a token length, and returns false if the payload ends.
+    inline bool bitplanes_read_length(const uint8_t*& payload, const uint8_t* end, std::size_t& length) {
+        for (;;) {
+            if (payload == end) {
+                return false;
+            }
+            const auto extension = *payload;
+            ++payload;
+            length += extension;
+            if (extension != 255) {
+                return true;
+            }
+        }
+    }
+
+    /// bitplanes_copy_match copies length bytes from offset bytes before target, the regions may overlap.
+    /// Overlapping matches repeat a pattern, which is copied in chunks of doubling size.
+    inline void bitplanes_copy_match(uint8_t* target, std::size_t offset, std::size_t length) {
+        const auto source = target - offset;
+        if (offset == 1) {
+            std::memset(target, *source, length);
+            return;
+        }
+        auto available = offset;
+        while (length > 0) {
+            const auto chunk = std::min(available, length);
+            std::memcpy(target, source, chunk);
+            target += chunk;
+            length -= chunk;
+            available += chunk;
+        }
+    }
+
+    /// bitplanes_decode decompresses the sequences of a frame to bytes.
+    /// Short literals and matches are copied 16 bytes at a time when the buffers allow it, the extra bytes are
+    /// overwritten by the next sequences.
+    inline void bitplanes_decode(const uint8_t* payload, std::size_t payload_size, uint8_t* bytes, std::size_t size) {
+        const auto end = payload + payload_size;
+        std::size_t position = 0;
+        while (position < size) {
+            if (payload == end) {
+                throw std::runtime_error("the bit-plane frame is truncated");
+            }
+            const auto token = *payload;
+            ++payload;
+            std::size_t literals = token >> 4;
+            if (literals == 15 && !bitplanes_read_length(payload, end, literals)) {
+                throw std::runtime_error("the bit-plane frame is truncated");
+            }
+            if (literals > static_cast<std::size_t>(end - payload) || literals > size - position) {
+                throw std::runtime_error("the bit-plane frame is corrupted");
+            }
+            if (literals <= 16 && end - payload >= 16 && size - position >= 16) {
+                std::memcpy(bytes + position, payload, 16);
+            } else {
+                std::memcpy(bytes + position, payload, literals);
+            }
+            payload += literals;
+            position += literals;
+            if (position == size) {
+                break;
+            }
+            if (end - payload < 2) {
+                throw std::runtime_error("the bit-plane frame is truncated");
+            }
+            const auto offset = static_cast<std::size_t>(payload[0]) | (static_cast<std::size_t>(payload[1]) << 8);
+            payload += 2;
+            std::size_t match = token & 0xf;
+            if (match == 15 && !bitplanes_read_length(payload, end, match)) {
+                throw std::runtime_error("the bit-plane frame is truncated");
+            }
+            match += bitplanes_minimum_match;
+            if (offset == 0 || offset > position || match > size - position) {
+                throw std::runtime_error("the bit-plane frame is corrupted");
+            }
+            if (offset >= 16 && match <= 16 && size - position >= 16) {
+                std::memcpy(bytes + position, bytes + position - offset, 16);
+            } else {
+                bitplanes_copy_match(bytes + position, offset, match);
+            }
+            position += match;
+        }
+        if (payload != end) {
+            throw std::runtime_error("the bit-plane frame is corrupted");
+        }
+    }
+
+    /// bitplanes_signature starts every bit-plane video.
+    const char bitplanes_signature[8] = {'H', 'B', 'P', 'L', 'A', 'N', 'E', 'S'};
+
+    /// bitplanes_version is the version of the container layout.
+    const uint32_t bitplanes_version = 1;
+
+    /// bitplanes_header_size is the number of bytes before the first frame.
+    /// The header holds, in little endian, the signature, the version, the width and height and the key frame
+    /// interval on 32 bits, and the frame size and the number of frames on 64 bits. Each frame is stored as a 32-bit
+    /// payload size, a type byte (0 for key frames, 1 for delta frames) and the payload.
+    const std::size_t bitplanes_header_size = 40;
+
+    /// is_bitplanes returns true if the file starts with the bit-plane video signature.
+    inline bool is_bitplanes(const std::string& filename) {
+        const auto file_descriptor = open(filename.c_str(), O_RDONLY);
+        if (file_descriptor < 0) {
+            return false;
+        }
+        char signature[sizeof(bitplanes_signature)];
+        const auto bytes_read = ::read(file_descriptor, signature, sizeof(signature));
+        ::close(file_descriptor);
+        return bytes_read == static_cast<ssize_t>(sizeof(signature))
+               && std::equal(std::begin(signature), std::end(signature), std::begin(bitplanes_signature));
+    }
+
+    /// bitplanes_writer compresses YUV420 frames to a bit-plane video.
+    /// Every key_frame_interval-th frame is a key frame, the other frames are stored as key or delta frames,
+    /// whichever is smaller.
+    /// Zero-size writes (such as the YUV4MPEG2 stream header) are ignored. The number of frames is written in the
+    /// header by close, hence a video is invalid until it is closed.
+    class bitplanes_writer : public frame_writer {
+        public:
+        bitplanes_writer(
+            const std::string& filename,
+            uint32_t width,
+            uint32_t height,
+            std::size_t frame_size,
+            uint32_t key_frame_interval = 60,
+            instruction_set set = detect_instruction_set()) :
+            _filename(filename),
+            _width(width),
+            _height(height),
+            _frame_size(frame_size),
+            _key_frame_interval(key_frame_interval),
+            _set(set),
+            _frames(0),
+            _previous(frame_size, 0),
+            _delta(frame_size, 0) {
+            if (key_frame_interval == 0) {
+                throw std::logic_error("the key frame interval must be larger than 0");
+            }
+            _file_descriptor = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (_file_descriptor < 0) {
+                throw std::runtime_error(std::string("'") + filename + "' could not be open for writing");
+            }
+            write_header();
+        }
+        bitplanes_writer(const bitplanes_writer&) = delete;
+        bitplanes_writer(bitplanes_writer&&) = default;
+        bitplanes_writer& operator=(const bitplanes_writer&) = delete;
+        bitplanes_writer& operator=(bitplanes_writer&&) = default;
+        virtual ~bitplanes_writer() {
+            if (_file_descriptor >= 0) {
+                ::close(_file_descriptor);
+            }
+        }
+
+        virtual void write(const std::string&, const uint8_t* bytes, std::size_t size) override {
+            if (size == 0) {
+                return;
+            }
+            if (size != _frame_size) {
+                throw std::logic_error("unexpected frame size");
+            }
+            if (_file_descriptor < 0) {
+                throw std::logic_error("the bit-plane video is closed");
+            }
+            _payload.assign(5, 0);
+            bitplanes_encode(bytes, size, _table, _payload);
+            if (_frames % _key_frame_interval != 0) {
+                std::copy(bytes, bytes + size, _delta.begin());
+                xor_bytes(_set, _delta.data(), _previous.data(), size);
+                _delta_payload.assign(5, 1);
+                bitplanes_encode(_delta.data(), size, _table, _delta_payload);
+                if (_delta_payload.size() < _payload.size()) {
+                    _payload.swap(_delta_payload);
+                }
+            }
+            std::copy(bytes, bytes + size, _previous.begin());
+            const auto payload_size = _payload.size() - 5;
+            if (payload_size > 0xffffffff) {
+                throw std::logic_error("the bit-plane frame is too large");
+            }
+            for (std::size_t index = 0; index < 4; ++index) {
+                _payload[index] = static_cast<uint8_t>(payload_size >> (index * 8));
+            }
+            write_bytes(_payload.data(), _payload.size());
+            ++_frames;
+        }
+
+        /// close writes the number of frames in the header and closes the file.
+        virtual void close() {
+            if (_file_descriptor < 0) {
+                return;
+            }
+            if (lseek(_file_descriptor, 0, SEEK_SET) < 0) {
+                throw std::runtime_error(std::string("seeking in '") + _filename + "' failed");
+            }
+            write_header();
+            if (::close(_file_descriptor) < 0) {
+                _file_descriptor = -1;
+                throw std::runtime_error(std::string("closing '") + _filename + "' failed");
+            }
+            _file_descriptor = -1;
+        }
+
+        /// frames returns the number of written frames.
+        std::size_t frames() const {
+            return _frames;
+        }
+
+        protected:
+        /// write_header writes the header at the current position.
+        void write_header() {
+            uint8_t header[bitplanes_header_size] = {};
+            std::copy(std::begin(bitplanes_signature), std::end(bitplanes_signature), header);
+            std::size_t offset = sizeof(bitplanes_signature);
+            const auto encode = [&](uint64_t value, std::size_t size) {
+                for (std::size_t index = 0; index < size; ++index) {
+                    header[offset + index] = static_cast<uint8_t>(value >> (index * 8));
+                }
+                offset += size;
+            };
+            encode(bitplanes_version, 4);
+            encode(_width, 4);
+            encode(_height, 4);
+            encode(_key_frame_interval, 4);
+            encode(_frame_size, 8);
+            encode(_frames, 8);
+            write_bytes(header, sizeof(header));
+        }
+
+        /// write_bytes writes all the given bytes, resuming after partial writes.
+        void write_bytes(const uint8_t* bytes, std::size_t size) {
+            while (size > 0) {
+                const auto bytes_written = ::write(_file_descriptor, bytes, size);
+                if (bytes_written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::runtime_error(
+                        std::string("writing '") + _filename + "' failed: " + std::strerror(errno));
+                }
+                bytes += bytes_written;
+                size -= static_cast<std::size_t>(bytes_written);
+            }
+        }
+
+        const std::string _filename;
+        const uint32_t _width;
+        const uint32_t _height;
+        const std::size_t _frame_size;
+        const uint32_t _key_frame_interval;
+        const instruction_set _set;
+        std::size_t _frames;
+        std::vector<uint8_t> _previous;
+        std::vector<uint8_t> _delta;
+        std::vector<uint32_t> _table;
+        std::vector<uint8_t> _payload;
+        std::vector<uint8_t> _delta_payload;
+        int _file_descriptor;
+    };
+
+    /// bitplanes_reader memory-maps a bit-plane video and decodes its frames in order.
+    class bitplanes_reader {
+        public:
+        bitplanes_reader(const std::string& filename, instruction_set set = detect_instruction_set()) :
+            _filename(filename),
+            _set(set),
+            _data(nullptr),
+            _size(0),
+            _offset(bitplanes_header_size),
+            _frame_index(0) {
+            const auto file_descriptor = open(filename.c_str(), O_RDONLY);
+            if (file_descriptor < 0) {
+                throw std::runtime_error(std::string("'") + filename + "' could not be open for reading");
+            }
+            struct stat status;
+            if (fstat(file_descriptor, &status) < 0) {
+                ::close(file_descriptor);
+                throw std::runtime_error(std::string("retrieving the size of '") + filename + "' failed");
+            }
+            _size = static_cast<std::size_t>(status.st_size);
+            if (_size < bitplanes_header_size) {
+                ::close(file_descriptor);
+                throw std::runtime_error(std::string("'") + filename + "' is not a bit-plane video");
+            }
+            auto data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+            ::close(file_descriptor);
+            if (data == MAP_FAILED) {
+                throw std::runtime_error(std::string("mapping '") + filename + "' failed");
+            }
+            _data = reinterpret_cast<const uint8_t*>(data);
+            madvise(data, _size, MADV_SEQUENTIAL);
+            std::size_t offset = sizeof(bitplanes_signature);
+            const auto decode = [&](std::size_t size) {
+                uint64_t value = 0;
+                for (std::size_t index = 0; index < size; ++index) {
+                    value |= static_cast<uint64_t>(_data[offset + index]) << (index * 8);
+                }
+                offset += size;
+                return value;
+            };
+            std::string error;
+            if (!std::equal(std::begin(bitplanes_signature), std::end(bitplanes_signature), _data)) {
+                error = "is not a bit-plane video";
+            } else if (decode(4) != bitplanes_version) {
+                error = "uses an unsupported bit-plane version";
+            } else {
+                _width = static_cast<uint32_t>(decode(4));
+                _height = static_cast<uint32_t>(decode(4));
+                _key_frame_interval = static_cast<uint32_t>(decode(4));
+                _frame_size = static_cast<std::size_t>(decode(8));
+                _frames = static_cast<std::size_t>(decode(8));
+            }
+            if (!error.empty()) {
+                munmap(data, _size);
+                throw std::runtime_error(std::string("'") + filename + "' " + error);
+            }
+            _frame.resize(_frame_size, 0);
+            _delta.resize(_frame_size, 0);
+        }
+        bitplanes_reader(const bitplanes_reader&) = delete;
+        bitplanes_reader(bitplanes_reader&&) = default;
+        bitplanes_reader& operator=(const bitplanes_reader&) = delete;
+        bitplanes_reader& operator=(bitplanes_reader&&) = default;
+        virtual ~bitplanes_reader() {
+            if (_data) {
+                munmap(const_cast<uint8_t*>(_data), _size);
+            }
+        }
+
+        /// read decodes the next frame and returns its bytes, or nullptr after the last frame.
+        /// The bytes remain valid until the next call.
+        virtual const uint8_t* read() {
+            if (_frame_index == _frames) {
+                return nullptr;
+            }
+            std::size_t payload_size;
+            bool key_frame;
+            read_record(_offset, payload_size, key_frame);
+            _offset += 5;
+            if (key_frame) {
+                bitplanes_decode(_data + _offset, payload_size, _frame.data(), _frame.size());
+            } else {
+                if (_frame_index == 0) {
+                    throw std::runtime_error(std::string("'") + _filename + "' does not start with a key frame");
+                }
+                bitplanes_decode(_data + _offset, payload_size, _delta.data(), _delta.size());
+                xor_bytes(_set, _frame.data(), _delta.data(), _delta.size());
+            }
+            _offset += payload_size;
+            ++_frame_index;
+            return _frame.data();
+        }
+
+        /// seek moves to a frame, so that the next read returns it.
+        /// The frame records are scanned from the beginning of the file, and the frames between the last key frame
+        /// and the target are decoded.
+        virtual void seek(std::size_t frame_index) {
+            if (frame_index >= _frames) {
+                throw std::runtime_error(
+                    std::string("'") + _filename + "' has " + std::to_string(_frames)
+                    + " frames, hence it cannot start at frame " + std::to_string(frame_index));
+            }
+            std::size_t key_offset = bitplanes_header_size;
+            std::size_t key_index = 0;
+            std::size_t offset = bitplanes_header_size;
+            for (std::size_t index = 0;; ++index) {
+                std::size_t payload_size;
+                bool key_frame;
+                read_record(offset, payload_size, key_frame);
+                if (key_frame) {
+                    key_offset = offset;
+                    key_index = index;
+                }
+                if (index == frame_index) {
+                    break;
+                }
+                offset += 5 + payload_size;
+            }
+            _offset = key_offset;
+            _frame_index = key_index;
+            while (_frame_index < frame_index) {
+                read();
+            }
+        }
+
+        /// width returns the number of columns of the display the frames were packed for.
+        uint32_t width() const {
+            return _width;
+        }
+
+        /// height returns the number of rows of the display the frames were packed for.
+        uint32_t height() const {
+            return _height;
+        }
+
+        /// frame_size returns the number of bytes in a decoded frame.
+        std::size_t frame_size() const {
+            return _frame_size;
+        }
+
+        /// frames returns the number of frames.
+        std::size_t frames() const {
+            return _frames;
+        }
+
+        /// key_frame_interval returns the number of frames between two key frames.
+        uint32_t key_frame_interval() const {
+            return _key_frame_interval;
+        }
+
+        protected:
+        /// read_record parses the header of the frame record at offset, and checks that its payload is complete.
+        void read_record(std::size_t offset, std::size_t& payload_size, bool& key_frame) const {
+            if (_size - offset < 5) {
+                throw std::runtime_error(std::string("'") + _filename + "' is truncated");
+            }
+            payload_size = 0;
+            for (std::size_t index = 0; index < 4; ++index) {
+                payload_size |= static_cast<std::size_t>(_data[offset + index]) << (index * 8);
+            }
+            key_frame = _data[offset + 4] == 0;
+            if (_size - offset - 5 < payload_size) {
+                throw std::runtime_error(std::string("'") + _filename + "' is truncated");
+            }
+        }
+
+        const std::string _filename;
+        const instruction_set _set;
+        const uint8_t* _data;
+        std::size_t _size;
+        std::size_t _offset;
+        uint32_t _width;
+        uint32_t _height;
+        uint32_t _key_frame_interval;
+        std::size_t _frame_size;
+        std::size_t _frames;
+        std::size_t _frame_index;
+        std::vector<uint8_t> _frame;
+        std::vector<uint8_t> _delta;
+    };
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "deinterleave.hpp"
+#include "encoder.hpp"
+#include <cstdio>
+#include <exception>
+#include <thread>
+
+/// hummingbird bundles tools to create and play high framerate videos.
+namespace hummingbird {
+    /// chunked_encode splits a Device::framerate / replicates raw stream into segments at frame boundaries, packs
+    /// and losslessly encodes each segment with its own encoder on its own thread, and concatenates the segments
+    /// into a single MP4 file. Each segment starts with a key frame and does not reference the others, hence the
+    /// decoded frames are identical to those of a single encoder.
+    /// The segments are written next to filename, and removed once concatenated.
+    template <typename Device = lightcrafter_1440_hz>
+    inline void chunked_encode(
+        const uint8_t* data,
+        std::size_t size,
+        const std::string& filename,
+        const std::string& preset,
+        bool bit_input,
+        std::size_t segments,
+        std::size_t encoder_threads = 0,
+        instruction_set set = detect_instruction_set(),
+        std::size_t replicates = 1) {
+        if (segments == 0) {
+            throw std::logic_error("the number of segments must be larger than 0");
+        }
+        if (replicates == 0 || Device::patterns_per_frame % replicates != 0) {
+            throw std::logic_error("the number of replicates must divide the number of patterns per frame");
+        }
+        const auto group_size =
+            (bit_input ? Device::pixels / 8 : Device::pixels) * (Device::patterns_per_frame / replicates);
+        const auto groups = size / group_size;
+        segments = std::max(std::min(segments, groups), static_cast<std::size_t>(1));
+        std::vector<std::string> filenames;
+        for (std::size_t segment = 0; segment < segments; ++segment) {
+            filenames.push_back(filename + ".segment-" + std::to_string(segment) + ".mp4");
+        }
+        std::vector<std::exception_ptr> exceptions(segments);
+        std::vector<std::thread> workers;
+        for (std::size_t segment = 0; segment < segments; ++segment) {
+            const auto first = groups * segment / segments;
+            const auto last = groups * (segment + 1) / segments;
+            workers.emplace_back([&, segment, first, last]() {
+                try {
+                    memory_frame_reader reader(data + first * group_size, (last - first) * group_size);
+                    encoder writer(filenames[segment], preset, Device::width * 2, Device::height, encoder_threads);
+                    deinterleave<Device>(reader, writer, bit_input, 1, set, replicates);
+                    writer.close();
+                } catch (...) {
+                    exceptions[segment] = std::current_exception();
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        const auto remove_segments = [&]() {
+            for (const auto& segment_filename : filenames) {
+                std::remove(segment_filename.c_str());
+            }
+        };
+        try {
+            for (const auto& exception : exceptions) {
+                if (exception) {
+                    std::rethrow_exception(exception);
+                }
+            }
+            concatenate(filenames, filename);
+        } catch (...) {
+            remove_segments();
+            throw;
+        }
+        remove_segments();
+    }
+}
@@ -1,21 +1,29 @@
 #pragma once
 
+#include "interleave.hpp"
+#include "keyframe_index.hpp"
 #include <atomic>
+#include <chrono>
 #include <functional>
 #include <glibmm/main.h>
 #include <gstreamermm.h>
 #include <gstreamermm/appsink.h>
 #include <gstreamermm/bin.h>
 #include <gstreamermm/caps.h>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <stdexcept>
 #include <string>
 #include <thread>
+#include <vector>
 
 /// hummingbird bundles tools to create and play high framerate videos.
 namespace hummingbird {
     /// decoder reads and decodes a H.264 stream inside any container known by
     /// avcodec.
+    /// Frames are counted at 60 Hz: a range of frames starts with a seek to the preceding key frame (found with a
+    /// keyframe_index), and the frames outside the range are decoded but not handled.
     template <typename HandleFrame>
     class decoder {
         public:
@@ -49,7 +57,12 @@ namespace hummingbird {
         }
 
         decoder(HandleFrame handle_frame, Glib::RefPtr<Gst::Element> h264_to_i420 = Glib::RefPtr<Gst::Element>()) :
-            _handle_frame(std::forward<HandleFrame>(handle_frame)) {
+            _handle_frame(std::forward<HandleFrame>(handle_frame)),
+            _frame_index(0),
+            _start_frame(0),
+            _end_frame(std::numeric_limits<std::size_t>::max()),
+            _open_duration(0),
+            _time_to_first_frame(-1) {
             Gst::init_check();
             _main_context = Glib::MainContext::create();
             _main_loop = Glib::MainLoop::create(_main_context);
@@ -101,9 +114,91 @@ namespace hummingbird {
 
         /// read opens a H.264 file and decodes its frames.
         virtual void read(const std::string& filename) {
-            _running.store(true, std::memory_order_release);
+            read(filename, 0, std::numeric_limits<std::size_t>::max());
+        }
+
+        /// read opens a H.264 file and decodes the frames in the range [start_frame, end_frame).
+        /// The time to the first frame includes the seek.
+        virtual void read(const std::string& filename, std::size_t start_frame, std::size_t end_frame) {
+            const auto begin = std::chrono::steady_clock::now();
+            open(filename, start_frame, end_frame);
+            play(begin);
+        }
+
+        /// open prerolls a H.264 file: the pipeline is built and the first frame decoded, but not handled.
+        /// open may be called while another decoder plays, so that play starts without delay.
+        virtual void open(const std::string& filename) {
+            open(filename, 0, std::numeric_limits<std::size_t>::max());
+        }
+
+        /// open prerolls a H.264 file from the last key frame at or before start_frame.
+        /// play then handles the frames in the range [start_frame, end_frame) only.
+        virtual void open(const std::string& filename, std::size_t start_frame, std::size_t end_frame) {
+            if (end_frame <= start_frame) {
+                throw std::logic_error("the end frame must be larger than the start frame");
+            }
+            const auto begin = std::chrono::steady_clock::now();
+            std::size_t keyframe = 0;
+            if (start_frame > 0) {
+                const keyframe_index index(filename);
+                if (start_frame >= index.frames()) {
+                    throw std::runtime_error(
+                        std::string("'") + filename + "' has " + std::to_string(index.frames())
+                        + " frames, hence it cannot start at frame " + std::to_string(start_frame));
+                }
+                keyframe = index.keyframe_before(start_frame);
+            }
             set_state(Gst::STATE_READY);
             _filesrc->set_property("location", filename);
+            set_state(Gst::STATE_PAUSED);
+            if (keyframe > 0) {
+                // seeking half a frame after the key frame and snapping to the previous key unit starts exactly at
+                // the key frame, regardless of timestamp rounding
+                if (!_pipeline->seek(
+                        Gst::FORMAT_TIME,
+                        Gst::SEEK_FLAG_FLUSH | Gst::SEEK_FLAG_KEY_UNIT | Gst::SEEK_FLAG_SNAP_BEFORE,
+                        static_cast<gint64>((2 * keyframe + 1) * Gst::SECOND / 120))) {
+                    throw std::runtime_error(std::string("seeking in '") + filename + "' failed");
+                }
+                wait_for_state();
+            }
+            _frame_index = keyframe;
+            _start_frame = start_frame;
+            _end_frame = end_frame;
+            _open_duration =
+                std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+        }
+
+        /// play handles the frames of the opened file, starting with the prerolled one, until the end of the stream
+        /// or of the range given to open.
+        virtual void play() {
+            play(std::chrono::steady_clock::now());
+        }
+
+        /// stop interrupts the stream being played.
+        virtual void stop() {
+            _running.store(false, std::memory_order_release);
+        }
+
+        /// open_duration returns the time spent by the last open (loading the key frame index, seeking and
+        /// prerolling), in microseconds. It must not be called while open runs on another thread.
+        int64_t open_duration() const {
+            return _open_duration;
+        }
+
+        /// time_to_first_frame returns the time between the beginning of the last read (or play) and its first handled
+        /// frame, in microseconds, or -1 if no frame was handled. It includes the frames decoded silently between the
+        /// key frame and the start frame.
+        int64_t time_to_first_frame() const {
+            return _time_to_first_frame.load(std::memory_order_acquire);
+        }
+
+        protected:
+        /// play handles the frames of the opened file, and measures the time to the first frame from begin.
+        virtual void play(std::chrono::steady_clock::time_point begin) {
+            _begin = begin;
+            _time_to_first_frame.store(-1, std::memory_order_release);
+            _running.store(true, std::memory_order_release);
             set_state(Gst::STATE_PLAYING);
             auto bus = _pipeline->get_bus();
             while (_running.load(std::memory_order_acquire)) {
@@ -127,12 +222,6 @@ namespace hummingbird {
             set_state(Gst::STATE_PAUSED);
         }
 
-        /// stop interrupts the stream being played.
-        virtual void stop() {
-            _running.store(false, std::memory_order_release);
-        }
-
-        protected:
         /// create builds a pipeline element.
         static Glib::RefPtr<Gst::Element> create(const std::string& name) {
             auto element = Gst::ElementFactory::create_element(name);
@@ -145,18 +234,39 @@ namespace hummingbird {
         /// set_state changes the pipeline state and waits for the change to happen.
         virtual void set_state(Gst::State state) {
             if (_pipeline->set_state(state) == Gst::STATE_CHANGE_ASYNC) {
-                Gst::State current_state;
-                Gst::State pending_state;
-                if (_pipeline->get_state(current_state, pending_state, Gst::CLOCK_TIME_NONE)
-                    == Gst::STATE_CHANGE_FAILURE) {
-                    throw std::logic_error("changing the state failed");
-                }
+                wait_for_state();
+            }
+        }
+
+        /// wait_for_state waits for an asynchronous state change (or the preroll after a seek) to complete.
+        virtual void wait_for_state() {
+            Gst::State current_state;
+            Gst::State pending_state;
+            if (_pipeline->get_state(current_state, pending_state, Gst::CLOCK_TIME_NONE) == Gst::STATE_CHANGE_FAILURE) {
+                throw std::logic_error("changing the state failed");
             }
         }
 
         /// handle_sample is called by the pipeline when a sample is available.
+        /// Frames before the start frame are dropped, and the end frame stops the stream.
         virtual Gst::FlowReturn handle_sample() {
-            _handle_frame(_sink->pull_sample()->get_buffer());
+            const auto sample = _sink->pull_sample();
+            const auto frame_index = _frame_index;
+            ++_frame_index;
+            if (frame_index < _start_frame) {
+                return Gst::FLOW_OK;
+            }
+            if (frame_index >= _end_frame) {
+                _running.store(false, std::memory_order_release);
+                return Gst::FLOW_OK;
+            }
+            if (frame_index == _start_frame) {
+                _time_to_first_frame.store(
+                    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _begin)
+                        .count(),
+                    std::memory_order_release);
+            }
+            _handle_frame(sample->get_buffer());
             return Gst::FLOW_OK;
         }
 
@@ -174,6 +284,12 @@ namespace hummingbird {
         Glib::RefPtr<Gst::AppSink> _sink;
         std::thread _loop;
         std::atomic_bool _running;
+        std::size_t _frame_index;
+        std::size_t _start_frame;
+        std::size_t _end_frame;
+        std::chrono::steady_clock::time_point _begin;
+        int64_t _open_duration;
+        std::atomic<int64_t> _time_to_first_frame;
     };
 
     /// make_decoder generates a decoder from a functor.
@@ -181,4 +297,64 @@ namespace hummingbird {
     std::unique_ptr<decoder<HandleFrame>> make_decoder(HandleFrame handle_frame) {
         return std::unique_ptr<decoder<HandleFrame>>(new decoder<HandleFrame>(std::forward<HandleFrame>(handle_frame)));
     }
+
+    /// mapped_buffer keeps a decoded buffer alive and mapped for reading.
+    class mapped_buffer {
+        public:
+        mapped_buffer(const Glib::RefPtr<Gst::Buffer>& buffer) : _buffer(buffer) {
+            if (!gst_buffer_map(_buffer->gobj(), &_info, GST_MAP_READ)) {
+                throw std::logic_error("mapping the buffer failed");
+            }
+        }
+        mapped_buffer(const mapped_buffer&) = delete;
+        mapped_buffer(mapped_buffer&&) = delete;
+        mapped_buffer& operator=(const mapped_buffer&) = delete;
+        mapped_buffer& operator=(mapped_buffer&&) = delete;
+        virtual ~mapped_buffer() {
+            gst_buffer_unmap(_buffer->gobj(), &_info);
+        }
+
+        /// data returns the first byte of the buffer.
+        const uint8_t* data() const {
+            return _info.data;
+        }
+
+        /// size returns the number of bytes in the buffer.
+        std::size_t size() const {
+            return _info.size;
+        }
+
+        protected:
+        Glib::RefPtr<Gst::Buffer> _buffer;
+        GstMapInfo _info;
+    };
+
+    /// share_frame returns the bytes of a decoded YUV420 buffer without copies, for displays which convert frames
+    /// on the GPU. The buffer remains mapped until the last copy of the returned pointer is destroyed.
+    template <typename Device = lightcrafter_1440_hz>
+    inline std::shared_ptr<const uint8_t> share_frame(const Glib::RefPtr<Gst::Buffer>& buffer) {
+        const auto mapped = std::make_shared<mapped_buffer>(buffer);
+        if (mapped->size() != Device::frame_size) {
+            throw std::logic_error("unexpected buffer size");
+        }
+        return std::shared_ptr<const uint8_t>(mapped, mapped->data());
+    }
+
+    /// interleave converts a decoded YUV420 buffer to RGB bytes.
+    /// rgbs must hold Device::frame_size bytes.
+    template <typename Device = lightcrafter_1440_hz>
+    inline void interleave(const Glib::RefPtr<Gst::Buffer>& buffer, uint8_t* rgbs) {
+        mapped_buffer mapped(buffer);
+        if (mapped.size() != Device::frame_size) {
+            throw std::logic_error("unexpected buffer size");
+        }
+        interleave<Device>(mapped.data(), rgbs);
+    }
+
+    /// interleave converts a decoded YUV420 buffer to RGB bytes.
+    template <typename Device = lightcrafter_1440_hz>
+    inline void interleave(const Glib::RefPtr<Gst::Buffer>& buffer, std::vector<uint8_t>& bytes) {
+        bytes.resize(Device::frame_size);
+        interleave<Device>(buffer, bytes.data());
+    }
 }
@@ -1,201 +1,906 @@
 #pragma once
 
-#include <bitset>
+#include "device.hpp"
+#include "instruction_set.hpp"
+#include "io.hpp"
+#include <condition_variable>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <exception>
 #include <istream>
+#include <mutex>
 #include <ostream>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
 /// hummingbird bundles tools to create and play high framerate videos.
 namespace hummingbird {
-    /// deinterleave converts a 1440 fps raw stream to a 60 fps YUV420 stream.
-    inline void deinterleave(std::istream& input, std::ostream& output, bool bit_input) {
-        std::vector<uint8_t> frame(608 * 684 * 3, 0);
-        uint8_t frame_index = 0;
-        uint8_t mask = 1;
-        output << "YUV4MPEG2 W1216 H684 F60:1 Ip C420\n";
-        if (bit_input) {
-            for (;;) {
-                std::vector<uint8_t> bytes(608 * 684 / 8);
-                std::size_t byte_index = 0;
-                input.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
-                if (input.eof()) {
-                    break;
-                }
-                {
-                    std::size_t pixel_index = 608 * 684 * 2;
-                    for (std::size_t y = 0; y < 684 / 2; ++y) {
-                        for (std::size_t x = 0; x < 608; x += 8) {
-                            std::bitset<8> bits(bytes[byte_index]);
-                            ++byte_index;
-                            for (uint8_t bit_index = 0; bit_index < bits.size(); ++bit_index) {
-                                if (bits[bit_index]) {
-                                    frame[pixel_index] |= mask;
-                                } else {
-                                    frame[pixel_index] &= (~mask);
-                                }
-                                ++pixel_index;
-                            }
-                        }
-                        pixel_index += 608;
-                    }
-                }
-                {
-                    std::size_t pixel_index = 608 * 684 * 2 + 608;
-                    for (std::size_t y = 0; y < 684 / 2; ++y) {
-                        for (std::size_t x = 0; x < 608; x += 8) {
-                            std::bitset<8> bits(bytes[byte_index]);
-                            ++byte_index;
-                            for (uint8_t bit_index = 0; bit_index < bits.size(); ++bit_index) {
-                                if (bits[bit_index]) {
-                                    frame[pixel_index] |= mask;
-                                } else {
-                                    frame[pixel_index] &= (~mask);
-                                }
-                                ++pixel_index;
-                            }
-                        }
-                        pixel_index += 608;
-                    }
-                }
-                byte_index = 0;
-                input.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
-                if (input.eof()) {
-                    break;
-                }
-                {
-                    std::size_t pixel_index = 0;
-                    for (std::size_t y = 0; y < 684; ++y) {
-                        for (std::size_t x = 0; x < 608; x += 8) {
-                            std::bitset<8> bits(bytes[byte_index]);
-                            ++byte_index;
-                            for (uint8_t bit_index = 0; bit_index < bits.size(); ++bit_index) {
-                                if (bits[bit_index]) {
-                                    frame[pixel_index] |= mask;
-                                } else {
-                                    frame[pixel_index] &= (~mask);
-                                }
-                                pixel_index += 2;
-                            }
-                        }
-                    }
-                }
-                byte_index = 0;
-                input.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
-                if (input.eof()) {
-                    break;
-                }
-                {
-                    std::size_t pixel_index = 1;
-                    for (std::size_t y = 0; y < 684; ++y) {
-                        for (std::size_t x = 0; x < 608; x += 8) {
-                            std::bitset<8> bits(bytes[byte_index]);
-                            ++byte_index;
-                            for (uint8_t bit_index = 0; bit_index < bits.size(); ++bit_index) {
-                                if (bits[bit_index]) {
-                                    frame[pixel_index] |= mask;
-                                } else {
-                                    frame[pixel_index] &= (~mask);
-                                }
-                                pixel_index += 2;
-                            }
-                        }
-                    }
-                }
-                if (frame_index == 21) {
-                    output << "FRAME\n";
-                    output.write(reinterpret_cast<const char*>(frame.data()), frame.size());
-                    frame_index = 0;
-                } else {
-                    frame_index += 3;
+    /// insert_bits_scalar writes packed bits (least significant bit first) to the mask bit of every stride-th pixel.
+    inline void
+    insert_bits_scalar(const uint8_t* bits, uint8_t* pixels, std::size_t count, std::size_t stride, uint8_t mask) {
+        const uint8_t inverse_mask = ~mask;
+        for (std::size_t index = 0; index < count; ++index) {
+            const uint8_t on = -static_cast<uint8_t>((bits[index / 8] >> (index % 8)) & 1);
+            pixels[index * stride] = (pixels[index * stride] & inverse_mask) | (on & mask);
+        }
+    }
+
+    /// insert_thresholds_scalar writes grey levels larger than 127 to the mask bit of every stride-th pixel.
+    inline void insert_thresholds_scalar(
+        const uint8_t* greys,
+        uint8_t* pixels,
+        std::size_t count,
+        std::size_t stride,
+        uint8_t mask) {
+        const uint8_t inverse_mask = ~mask;
+        for (std::size_t index = 0; index < count; ++index) {
+            const uint8_t on = -static_cast<uint8_t>(greys[index] >> 7);
+            pixels[index * stride] = (pixels[index * stride] & inverse_mask) | (on & mask);
+        }
+    }
+
+    /// replicate_fields_scalar copies the depth most significant bits of a grey level to every depth-bit field.
+    inline uint8_t replicate_fields_scalar(uint8_t grey, uint8_t depth) {
+        auto fields = static_cast<uint8_t>(grey & (0xff << (8 - depth)));
+        for (uint8_t step = depth; step < 8; step *= 2) {
+            fields |= fields >> step;
+        }
+        return fields;
+    }
+
+    /// insert_fields_scalar writes the depth most significant bits of grey levels to the mask bits of every
+    /// stride-th pixel. The mask may cover several depth-bit fields, which then receive the same value.
+    inline void insert_fields_scalar(
+        const uint8_t* greys,
+        uint8_t* pixels,
+        std::size_t count,
+        std::size_t stride,
+        uint8_t mask,
+        uint8_t depth) {
+        const uint8_t inverse_mask = ~mask;
+        for (std::size_t index = 0; index < count; ++index) {
+            pixels[index * stride] =
+                (pixels[index * stride] & inverse_mask) | (replicate_fields_scalar(greys[index], depth) & mask);
+        }
+    }
+
+#if defined(HUMMINGBIRD_X86)
+    /// insert_bits_sse2 is the SSE2 implementation of insert_bits.
+    __attribute__((target("sse2"))) inline void
+    insert_bits_sse2(const uint8_t* bits, uint8_t* pixels, std::size_t count, uint8_t mask) {
+        const auto selectors = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+        const auto masks = _mm_set1_epi8(static_cast<char>(mask));
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            uint16_t two_bytes;
+            std::memcpy(&two_bytes, bits + index / 8, sizeof(two_bytes));
+            auto ons = _mm_cvtsi32_si128(two_bytes);
+            ons = _mm_unpacklo_epi8(ons, ons);
+            ons = _mm_unpacklo_epi16(ons, ons);
+            ons = _mm_unpacklo_epi32(ons, ons);
+            ons = _mm_cmpeq_epi8(_mm_and_si128(ons, selectors), selectors);
+            const auto target = reinterpret_cast<__m128i*>(pixels + index);
+            _mm_storeu_si128(
+                target, _mm_or_si128(_mm_andnot_si128(masks, _mm_loadu_si128(target)), _mm_and_si128(ons, masks)));
+        }
+        insert_bits_scalar(bits + index / 8, pixels + index, count - index, 1, mask);
+    }
+
+    /// insert_interleaved_bits_sse2 is the SSE2 implementation of insert_interleaved_bits.
+    __attribute__((target("sse2"))) inline void
+    insert_interleaved_bits_sse2(const uint8_t* bits, uint8_t* pixels, std::size_t count, uint8_t mask) {
+        const auto selectors = _mm_setr_epi8(1, 0, 2, 0, 4, 0, 8, 0, 16, 0, 32, 0, 64, 0, -128, 0);
+        const auto masks = _mm_set1_epi16(mask);
+        std::size_t index = 0;
+        for (; index + 8 <= count; index += 8) {
+            auto ons = _mm_set1_epi8(static_cast<char>(bits[index / 8]));
+            ons = _mm_cmpeq_epi8(_mm_and_si128(ons, selectors), selectors);
+            const auto target = reinterpret_cast<__m128i*>(pixels + index * 2);
+            _mm_storeu_si128(
+                target, _mm_or_si128(_mm_andnot_si128(masks, _mm_loadu_si128(target)), _mm_and_si128(ons, masks)));
+        }
+        insert_bits_scalar(bits + index / 8, pixels + index * 2, count - index, 2, mask);
+    }
+
+    /// insert_thresholds_sse2 is the SSE2 implementation of insert_thresholds.
+    __attribute__((target("sse2"))) inline void
+    insert_thresholds_sse2(const uint8_t* greys, uint8_t* pixels, std::size_t count, uint8_t mask) {
+        const auto zeros = _mm_setzero_si128();
+        const auto masks = _mm_set1_epi8(static_cast<char>(mask));
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            const auto ons = _mm_cmplt_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(greys + index)), zeros);
+            const auto target = reinterpret_cast<__m128i*>(pixels + index);
+            _mm_storeu_si128(
+                target, _mm_or_si128(_mm_andnot_si128(masks, _mm_loadu_si128(target)), _mm_and_si128(ons, masks)));
+        }
+        insert_thresholds_scalar(greys + index, pixels + index, count - index, 1, mask);
+    }
+
+    /// insert_interleaved_thresholds_sse2 is the SSE2 implementation of insert_interleaved_thresholds.
+    __attribute__((target("sse2"))) inline void
+    insert_interleaved_thresholds_sse2(const uint8_t* greys, uint8_t* pixels, std::size_t count, uint8_t mask) {
+        const auto zeros = _mm_setzero_si128();
+        const auto masks = _mm_set1_epi16(mask);
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            const auto ons = _mm_cmplt_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(greys + index)), zeros);
+            const auto low_target = reinterpret_cast<__m128i*>(pixels + index * 2);
+            const auto high_target = reinterpret_cast<__m128i*>(pixels + index * 2 + 16);
+            _mm_storeu_si128(
+                low_target,
+                _mm_or_si128(
+                    _mm_andnot_si128(masks, _mm_loadu_si128(low_target)),
+                    _mm_and_si128(_mm_unpacklo_epi8(ons, ons), masks)));
+            _mm_storeu_si128(
+                high_target,
+                _mm_or_si128(
+                    _mm_andnot_si128(masks, _mm_loadu_si128(high_target)),
+                    _mm_and_si128(_mm_unpackhi_epi8(ons, ons), masks)));
+        }
+        insert_thresholds_scalar(greys + index, pixels + index * 2, count - index, 2, mask);
+    }
+
+    /// replicate_fields_sse2 is the SSE2 implementation of replicate_fields_scalar.
+    __attribute__((target("sse2"))) inline __m128i replicate_fields_sse2(__m128i greys, uint8_t depth) {
+        auto fields = _mm_and_si128(greys, _mm_set1_epi8(static_cast<char>(0xff << (8 - depth))));
+        for (uint8_t step = depth; step < 8; step *= 2) {
+            fields = _mm_or_si128(
+                fields,
+                _mm_and_si128(
+                    _mm_srl_epi16(fields, _mm_cvtsi32_si128(step)), _mm_set1_epi8(static_cast<char>(0xff >> step))));
+        }
+        return fields;
+    }
+
+    /// insert_fields_sse2 is the SSE2 implementation of insert_fields.
+    __attribute__((target("sse2"))) inline void
+    insert_fields_sse2(const uint8_t* greys, uint8_t* pixels, std::size_t count, uint8_t mask, uint8_t depth) {
+        const auto masks = _mm_set1_epi8(static_cast<char>(mask));
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            const auto fields = _mm_and_si128(
+                replicate_fields_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(greys + index)), depth), masks);
+            const auto target = reinterpret_cast<__m128i*>(pixels + index);
+            _mm_storeu_si128(target, _mm_or_si128(_mm_andnot_si128(masks, _mm_loadu_si128(target)), fields));
+        }
+        insert_fields_scalar(greys + index, pixels + index, count - index, 1, mask, depth);
+    }
+
+    /// insert_interleaved_fields_sse2 is the SSE2 implementation of insert_interleaved_fields.
+    __attribute__((target("sse2"))) inline void insert_interleaved_fields_sse2(
+        const uint8_t* greys,
+        uint8_t* pixels,
+        std::size_t count,
+        uint8_t mask,
+        uint8_t depth) {
+        const auto masks = _mm_set1_epi16(mask);
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            const auto fields =
+                replicate_fields_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(greys + index)), depth);
+            const auto low_target = reinterpret_cast<__m128i*>(pixels + index * 2);
+            const auto high_target = reinterpret_cast<__m128i*>(pixels + index * 2 + 16);
+            _mm_storeu_si128(
+                low_target,
+                _mm_or_si128(
+                    _mm_andnot_si128(masks, _mm_loadu_si128(low_target)),
+                    _mm_and_si128(_mm_unpacklo_epi8(fields, fields), masks)));
+            _mm_storeu_si128(
+                high_target,
+                _mm_or_si128(
+                    _mm_andnot_si128(masks, _mm_loadu_si128(high_target)),
+                    _mm_and_si128(_mm_unpackhi_epi8(fields, fields), masks)));
+        }
+        insert_fields_scalar(greys + index, pixels + index * 2, count - index, 2, mask, depth);
+    }
+
+    /// insert_bits_avx2 is the AVX2 implementation of insert_bits.
+    __attribute__((target("avx2"))) inline void
+    insert_bits_avx2(const uint8_t* bits, uint8_t* pixels, std::size_t count, uint8_t mask) {
+        const auto shuffle = _mm256_setr_epi8(
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+        const auto selectors =
+            _mm256_broadcastsi128_si256(_mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128));
+        const auto masks = _mm256_set1_epi8(static_cast<char>(mask));
+        std::size_t index = 0;
+        for (; index + 32 <= count; index += 32) {
+            int32_t four_bytes;
+            std::memcpy(&four_bytes, bits + index / 8, sizeof(four_bytes));
+            auto ons = _mm256_shuffle_epi8(_mm256_set1_epi32(four_bytes), shuffle);
+            ons = _mm256_cmpeq_epi8(_mm256_and_si256(ons, selectors), selectors);
+            const auto target = reinterpret_cast<__m256i*>(pixels + index);
+            _mm256_storeu_si256(
+                target,
+                _mm256_or_si256(
+                    _mm256_andnot_si256(masks, _mm256_loadu_si256(target)), _mm256_and_si256(ons, masks)));
+        }
+        insert_bits_sse2(bits + index / 8, pixels + index, count - index, mask);
+    }
+
+    /// insert_interleaved_bits_avx2 is the AVX2 implementation of insert_interleaved_bits.
+    __attribute__((target("avx2"))) inline void
+    insert_interleaved_bits_avx2(const uint8_t* bits, uint8_t* pixels, std::size_t count, uint8_t mask) {
+        const auto shuffle = _mm256_setr_epi8(
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1);
+        const auto selectors =
+            _mm256_broadcastsi128_si256(_mm_setr_epi8(1, 0, 2, 0, 4, 0, 8, 0, 16, 0, 32, 0, 64, 0, -128, 0));
+        const auto masks = _mm256_set1_epi16(mask);
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            int16_t two_bytes;
+            std::memcpy(&two_bytes, bits + index / 8, sizeof(two_bytes));
+            auto ons = _mm256_shuffle_epi8(_mm256_set1_epi16(two_bytes), shuffle);
+            ons = _mm256_cmpeq_epi8(_mm256_and_si256(ons, selectors), selectors);
+            const auto target = reinterpret_cast<__m256i*>(pixels + index * 2);
+            _mm256_storeu_si256(
+                target,
+                _mm256_or_si256(
+                    _mm256_andnot_si256(masks, _mm256_loadu_si256(target)), _mm256_and_si256(ons, masks)));
+        }
+        insert_interleaved_bits_sse2(bits + index / 8, pixels + index * 2, count - index, mask);
+    }
+    /// insert_thresholds_avx2 is the AVX2 implementation of insert_thresholds.
+    __attribute__((target("avx2"))) inline void
+    insert_thresholds_avx2(const uint8_t* greys, uint8_t* pixels, std::size_t count, uint8_t mask) {
+        const auto zeros = _mm256_setzero_si256();
+        const auto masks = _mm256_set1_epi8(static_cast<char>(mask));
+        std::size_t index = 0;
+        for (; index + 32 <= count; index += 32) {
+            const auto ons =
+                _mm256_cmpgt_epi8(zeros, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(greys + index)));
+            const auto target = reinterpret_cast<__m256i*>(pixels + index);
+            _mm256_storeu_si256(
+                target,
+                _mm256_or_si256(
+                    _mm256_andnot_si256(masks, _mm256_loadu_si256(target)), _mm256_and_si256(ons, masks)));
+        }
+        insert_thresholds_sse2(greys + index, pixels + index, count - index, mask);
+    }
+
+    /// insert_interleaved_thresholds_avx2 is the AVX2 implementation of insert_interleaved_thresholds.
+    __attribute__((target("avx2"))) inline void
+    insert_interleaved_thresholds_avx2(const uint8_t* greys, uint8_t* pixels, std::size_t count, uint8_t mask) {
+        const auto zeros = _mm256_setzero_si256();
+        const auto masks = _mm256_set1_epi16(mask);
+        std::size_t index = 0;
+        for (; index + 32 <= count; index += 32) {
+            const auto ons = _mm256_permute4x64_epi64(
+                _mm256_cmpgt_epi8(zeros, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(greys + index))),
+                0xd8);
+            const auto low_target = reinterpret_cast<__m256i*>(pixels + index * 2);
+            const auto high_target = reinterpret_cast<__m256i*>(pixels + index * 2 + 32);
+            _mm256_storeu_si256(
+                low_target,
+                _mm256_or_si256(
+                    _mm256_andnot_si256(masks, _mm256_loadu_si256(low_target)),
+                    _mm256_and_si256(_mm256_unpacklo_epi8(ons, ons), masks)));
+            _mm256_storeu_si256(
+                high_target,
+                _mm256_or_si256(
+                    _mm256_andnot_si256(masks, _mm256_loadu_si256(high_target)),
+                    _mm256_and_si256(_mm256_unpackhi_epi8(ons, ons), masks)));
+        }
+        insert_interleaved_thresholds_sse2(greys + index, pixels + index * 2, count - index, mask);
+    }
+    /// replicate_fields_avx2 is the AVX2 implementation of replicate_fields_scalar.
+    __attribute__((target("avx2"))) inline __m256i replicate_fields_avx2(__m256i greys, uint8_t depth) {
+        auto fields = _mm256_and_si256(greys, _mm256_set1_epi8(static_cast<char>(0xff << (8 - depth))));
+        for (uint8_t step = depth; step < 8; step *= 2) {
+            fields = _mm256_or_si256(
+                fields,
+                _mm256_and_si256(
+                    _mm256_srl_epi16(fields, _mm_cvtsi32_si128(step)),
+                    _mm256_set1_epi8(static_cast<char>(0xff >> step))));
+        }
+        return fields;
+    }
+
+    /// insert_fields_avx2 is the AVX2 implementation of insert_fields.
+    __attribute__((target("avx2"))) inline void
+    insert_fields_avx2(const uint8_t* greys, uint8_t* pixels, std::size_t count, uint8_t mask, uint8_t depth) {
+        const auto masks = _mm256_set1_epi8(static_cast<char>(mask));
+        std::size_t index = 0;
+        for (; index + 32 <= count; index += 32) {
+            const auto fields = _mm256_and_si256(
+                replicate_fields_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(greys + index)), depth),
+                masks);
+            const auto target = reinterpret_cast<__m256i*>(pixels + index);
+            _mm256_storeu_si256(
+                target, _mm256_or_si256(_mm256_andnot_si256(masks, _mm256_loadu_si256(target)), fields));
+        }
+        insert_fields_sse2(greys + index, pixels + index, count - index, mask, depth);
+    }
+
+    /// insert_interleaved_fields_avx2 is the AVX2 implementation of insert_interleaved_fields.
+    __attribute__((target("avx2"))) inline void insert_interleaved_fields_avx2(
+        const uint8_t* greys,
+        uint8_t* pixels,
+        std::size_t count,
+        uint8_t mask,
+        uint8_t depth) {
+        const auto masks = _mm256_set1_epi16(mask);
+        std::size_t index = 0;
+        for (; index + 32 <= count; index += 32) {
+            const auto fields = _mm256_permute4x64_epi64(
+                replicate_fields_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(greys + index)), depth),
+                0xd8);
+            const auto low_target = reinterpret_cast<__m256i*>(pixels + index * 2);
+            const auto high_target = reinterpret_cast<__m256i*>(pixels + index * 2 + 32);
+            _mm256_storeu_si256(
+                low_target,
+                _mm256_or_si256(
+                    _mm256_andnot_si256(masks, _mm256_loadu_si256(low_target)),
+                    _mm256_and_si256(_mm256_unpacklo_epi8(fields, fields), masks)));
+            _mm256_storeu_si256(
+                high_target,
+                _mm256_or_si256(
+                    _mm256_andnot_si256(masks, _mm256_loadu_si256(high_target)),
+                    _mm256_and_si256(_mm256_unpackhi_epi8(fields, fields), masks)));
+        }
+        insert_interleaved_fields_sse2(greys + index, pixels + index * 2, count - index, mask, depth);
+    }
+#elif defined(HUMMINGBIRD_NEON)
+    /// insert_bits_neon is the NEON implementation of insert_bits.
+    inline void insert_bits_neon(const uint8_t* bits, uint8_t* pixels, std::size_t count, uint8_t mask) {
+        const uint8_t selectors_bytes[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+        const auto selectors = vld1q_u8(selectors_bytes);
+        const auto masks = vdupq_n_u8(mask);
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            const auto ons =
+                vtstq_u8(vcombine_u8(vdup_n_u8(bits[index / 8]), vdup_n_u8(bits[index / 8 + 1])), selectors);
+            vst1q_u8(pixels + index, vbslq_u8(masks, ons, vld1q_u8(pixels + index)));
+        }
+        insert_bits_scalar(bits + index / 8, pixels + index, count - index, 1, mask);
+    }
+
+    /// insert_interleaved_bits_neon is the NEON implementation of insert_interleaved_bits.
+    inline void insert_interleaved_bits_neon(const uint8_t* bits, uint8_t* pixels, std::size_t count, uint8_t mask) {
+        const uint8_t selectors_bytes[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+        const auto selectors = vld1q_u8(selectors_bytes);
+        const auto masks = vdupq_n_u8(mask);
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            const auto ons =
+                vtstq_u8(vcombine_u8(vdup_n_u8(bits[index / 8]), vdup_n_u8(bits[index / 8 + 1])), selectors);
+            auto pairs = vld2q_u8(pixels + index * 2);
+            pairs.val[0] = vbslq_u8(masks, ons, pairs.val[0]);
+            vst2q_u8(pixels + index * 2, pairs);
+        }
+        insert_bits_scalar(bits + index / 8, pixels + index * 2, count - index, 2, mask);
+    }
+    /// insert_thresholds_neon is the NEON implementation of insert_thresholds.
+    inline void insert_thresholds_neon(const uint8_t* greys, uint8_t* pixels, std::size_t count, uint8_t mask) {
+        const auto selectors = vdupq_n_u8(0x80);
+        const auto masks = vdupq_n_u8(mask);
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            const auto ons = vtstq_u8(vld1q_u8(greys + index), selectors);
+            vst1q_u8(pixels + index, vbslq_u8(masks, ons, vld1q_u8(pixels + index)));
+        }
+        insert_thresholds_scalar(greys + index, pixels + index, count - index, 1, mask);
+    }
+
+    /// insert_interleaved_thresholds_neon is the NEON implementation of insert_interleaved_thresholds.
+    inline void
+    insert_interleaved_thresholds_neon(const uint8_t* greys, uint8_t* pixels, std::size_t count, uint8_t mask) {
+        const auto selectors = vdupq_n_u8(0x80);
+        const auto masks = vdupq_n_u8(mask);
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            const auto ons = vtstq_u8(vld1q_u8(greys + index), selectors);
+            auto pairs = vld2q_u8(pixels + index * 2);
+            pairs.val[0] = vbslq_u8(masks, ons, pairs.val[0]);
+            vst2q_u8(pixels + index * 2, pairs);
+        }
+        insert_thresholds_scalar(greys + index, pixels + index * 2, count - index, 2, mask);
+    }
+    /// replicate_fields_neon is the NEON implementation of replicate_fields_scalar.
+    inline uint8x16_t replicate_fields_neon(uint8x16_t greys, uint8_t depth) {
+        auto fields = vandq_u8(greys, vdupq_n_u8(static_cast<uint8_t>(0xff << (8 - depth))));
+        for (uint8_t step = depth; step < 8; step *= 2) {
+            fields = vorrq_u8(fields, vshlq_u8(fields, vdupq_n_s8(-static_cast<int8_t>(step))));
+        }
+        return fields;
+    }
+
+    /// insert_fields_neon is the NEON implementation of insert_fields.
+    inline void
+    insert_fields_neon(const uint8_t* greys, uint8_t* pixels, std::size_t count, uint8_t mask, uint8_t depth) {
+        const auto masks = vdupq_n_u8(mask);
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            const auto fields = replicate_fields_neon(vld1q_u8(greys + index), depth);
+            vst1q_u8(pixels + index, vbslq_u8(masks, fields, vld1q_u8(pixels + index)));
+        }
+        insert_fields_scalar(greys + index, pixels + index, count - index, 1, mask, depth);
+    }
+
+    /// insert_interleaved_fields_neon is the NEON implementation of insert_interleaved_fields.
+    inline void insert_interleaved_fields_neon(
+        const uint8_t* greys,
+        uint8_t* pixels,
+        std::size_t count,
+        uint8_t mask,
+        uint8_t depth) {
+        const auto masks = vdupq_n_u8(mask);
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            const auto fields = replicate_fields_neon(vld1q_u8(greys + index), depth);
+            auto pairs = vld2q_u8(pixels + index * 2);
+            pairs.val[0] = vbslq_u8(masks, fields, pairs.val[0]);
+            vst2q_u8(pixels + index * 2, pairs);
+        }
+        insert_fields_scalar(greys + index, pixels + index * 2, count - index, 2, mask, depth);
+    }
+#endif
+
+    /// insert_bits writes packed bits (least significant bit first) to the mask bit of consecutive pixels.
+    /// count must be a multiple of 8.
+    inline void insert_bits(
+        instruction_set set,
+        const uint8_t* bits,
+        uint8_t* pixels,
+        std::size_t count,
+        uint8_t mask) {
+        switch (set) {
+#if defined(HUMMINGBIRD_X86)
+            case instruction_set::ssse3:
+            case instruction_set::sse2:
+                insert_bits_sse2(bits, pixels, count, mask);
+                return;
+            case instruction_set::avx2:
+                insert_bits_avx2(bits, pixels, count, mask);
+                return;
+#elif defined(HUMMINGBIRD_NEON)
+            case instruction_set::neon:
+                insert_bits_neon(bits, pixels, count, mask);
+                return;
+#endif
+            default:
+                insert_bits_scalar(bits, pixels, count, 1, mask);
+        }
+    }
+
+    /// insert_interleaved_bits writes packed bits (least significant bit first) to the mask bit of every other pixel.
+    /// count must be a multiple of 8.
+    inline void insert_interleaved_bits(
+        instruction_set set,
+        const uint8_t* bits,
+        uint8_t* pixels,
+        std::size_t count,
+        uint8_t mask) {
+        switch (set) {
+#if defined(HUMMINGBIRD_X86)
+            case instruction_set::ssse3:
+            case instruction_set::sse2:
+                insert_interleaved_bits_sse2(bits, pixels, count, mask);
+                return;
+            case instruction_set::avx2:
+                insert_interleaved_bits_avx2(bits, pixels, count, mask);
+                return;
+#elif defined(HUMMINGBIRD_NEON)
+            case instruction_set::neon:
+                insert_interleaved_bits_neon(bits, pixels, count, mask);
+                return;
+#endif
+            default:
+                insert_bits_scalar(bits, pixels, count, 2, mask);
+        }
+    }
+
+    /// insert_thresholds writes grey levels larger than 127 to the mask bit of consecutive pixels.
+    inline void insert_thresholds(
+        instruction_set set,
+        const uint8_t* greys,
+        uint8_t* pixels,
+        std::size_t count,
+        uint8_t mask) {
+        switch (set) {
+#if defined(HUMMINGBIRD_X86)
+            case instruction_set::ssse3:
+            case instruction_set::sse2:
+                insert_thresholds_sse2(greys, pixels, count, mask);
+                return;
+            case instruction_set::avx2:
+                insert_thresholds_avx2(greys, pixels, count, mask);
+                return;
+#elif defined(HUMMINGBIRD_NEON)
+            case instruction_set::neon:
+                insert_thresholds_neon(greys, pixels, count, mask);
+                return;
+#endif
+            default:
+                insert_thresholds_scalar(greys, pixels, count, 1, mask);
+        }
+    }
+
+    /// insert_interleaved_thresholds writes grey levels larger than 127 to the mask bit of every other pixel.
+    inline void insert_interleaved_thresholds(
+        instruction_set set,
+        const uint8_t* greys,
+        uint8_t* pixels,
+        std::size_t count,
+        uint8_t mask) {
+        switch (set) {
+#if defined(HUMMINGBIRD_X86)
+            case instruction_set::ssse3:
+            case instruction_set::sse2:
+                insert_interleaved_thresholds_sse2(greys, pixels, count, mask);
+                return;
+            case instruction_set::avx2:
+                insert_interleaved_thresholds_avx2(greys, pixels, count, mask);
+                return;
+#elif defined(HUMMINGBIRD_NEON)
+            case instruction_set::neon:
+                insert_interleaved_thresholds_neon(greys, pixels, count, mask);
+                return;
+#endif
+            default:
+                insert_thresholds_scalar(greys, pixels, count, 2, mask);
+        }
+    }
+
+    /// insert_fields writes the depth most significant bits of grey levels to the mask bits of consecutive pixels.
+    /// The mask may cover several depth-bit fields, which then receive the same value.
+    inline void insert_fields(
+        instruction_set set,
+        const uint8_t* greys,
+        uint8_t* pixels,
+        std::size_t count,
+        uint8_t mask,
+        uint8_t depth) {
+        switch (set) {
+#if defined(HUMMINGBIRD_X86)
+            case instruction_set::ssse3:
+            case instruction_set::sse2:
+                insert_fields_sse2(greys, pixels, count, mask, depth);
+                return;
+            case instruction_set::avx2:
+                insert_fields_avx2(greys, pixels, count, mask, depth);
+                return;
+#elif defined(HUMMINGBIRD_NEON)
+            case instruction_set::neon:
+                insert_fields_neon(greys, pixels, count, mask, depth);
+                return;
+#endif
+            default:
+                insert_fields_scalar(greys, pixels, count, 1, mask, depth);
+        }
+    }
+
+    /// insert_interleaved_fields writes the depth most significant bits of grey levels to the mask bits of every
+    /// other pixel. The mask may cover several depth-bit fields, which then receive the same value.
+    inline void insert_interleaved_fields(
+        instruction_set set,
+        const uint8_t* greys,
+        uint8_t* pixels,
+        std::size_t count,
+        uint8_t mask,
+        uint8_t depth) {
+        switch (set) {
+#if defined(HUMMINGBIRD_X86)
+            case instruction_set::ssse3:
+            case instruction_set::sse2:
+                insert_interleaved_fields_sse2(greys, pixels, count, mask, depth);
+                return;
+            case instruction_set::avx2:
+                insert_interleaved_fields_avx2(greys, pixels, count, mask, depth);
+                return;
+#elif defined(HUMMINGBIRD_NEON)
+            case instruction_set::neon:
+                insert_interleaved_fields_neon(greys, pixels, count, mask, depth);
+                return;
+#endif
+            default:
+                insert_fields_scalar(greys, pixels, count, 2, mask, depth);
+        }
+    }
+
+    /// deinterleave_pixels writes count pixels of a raw pattern, starting at first, to the mask bits of a channel in
+    /// a YUV420 frame. Channel 0 is stored in the U and V planes, channels 1 and 2 in the even and odd Y bytes.
+    /// Channel 0 ranges must not cross rows. Bit input (packed bits, least significant bit first) requires one bit per
+    /// pattern and first must be a multiple of 8.
+    template <typename Device>
+    inline void deinterleave_pixels(
+        instruction_set set,
+        bool bit_input,
+        uint8_t channel,
+        uint8_t mask,
+        const uint8_t* bytes,
+        uint8_t* frame,
+        std::size_t first,
+        std::size_t count) {
+        if (channel == 0) {
+            const auto y = first / Device::width;
+            const auto pixels = frame + Device::pixels * 2
+                                + ((y % (Device::height / 2)) * 2 + y / (Device::height / 2)) * Device::width
+                                + first % Device::width;
+            if (bit_input) {
+                insert_bits(set, bytes + first / 8, pixels, count, mask);
+            } else if (Device::bits_per_pattern == 1) {
+                insert_thresholds(set, bytes + first, pixels, count, mask);
+            } else {
+                insert_fields(set, bytes + first, pixels, count, mask, Device::bits_per_pattern);
+            }
+        } else {
+            const auto pixels = frame + first * 2 + (channel - 1);
+            if (bit_input) {
+                insert_interleaved_bits(set, bytes + first / 8, pixels, count, mask);
+            } else if (Device::bits_per_pattern == 1) {
+                insert_interleaved_thresholds(set, bytes + first, pixels, count, mask);
+            } else {
+                insert_interleaved_fields(set, bytes + first, pixels, count, mask, Device::bits_per_pattern);
+            }
+        }
+    }
+
+    /// deinterleave_channel writes a raw pattern to the mask bits of a channel in a YUV420 frame.
+    template <typename Device>
+    inline void deinterleave_channel(
+        instruction_set set,
+        bool bit_input,
+        uint8_t channel,
+        uint8_t mask,
+        const uint8_t* bytes,
+        uint8_t* frame) {
+        if (channel == 0) {
+            for (std::size_t y = 0; y < Device::height; ++y) {
+                deinterleave_pixels<Device>(
+                    set, bit_input, channel, mask, bytes, frame, y * Device::width, Device::width);
+            }
+        } else {
+            deinterleave_pixels<Device>(set, bit_input, channel, mask, bytes, frame, 0, Device::pixels);
+        }
+    }
+
+    /// deinterleave_pattern writes a raw pattern to its bit planes in a YUV420 frame.
+    template <typename Device>
+    inline void deinterleave_pattern(
+        instruction_set set,
+        bool bit_input,
+        std::size_t pattern,
+        const uint8_t* bytes,
+        uint8_t* frame) {
+        deinterleave_channel<Device>(
+            set, bit_input, Device::pattern_channel(pattern), Device::pattern_mask(pattern), bytes, frame);
+    }
+
+    /// deinterleave_replicated_pattern writes a raw pattern to the bit planes of replicates consecutive patterns,
+    /// starting at first. The bit planes that share a channel are written in a single pass.
+    template <typename Device>
+    inline void deinterleave_replicated_pattern(
+        instruction_set set,
+        bool bit_input,
+        std::size_t first,
+        std::size_t replicates,
+        const uint8_t* bytes,
+        uint8_t* frame) {
+        for (uint8_t channel = 0; channel < 3; ++channel) {
+            uint8_t mask = 0;
+            for (auto pattern = first; pattern < first + replicates; ++pattern) {
+                if (Device::pattern_channel(pattern) == channel) {
+                    mask |= Device::pattern_mask(pattern);
                 }
-                mask = (1 << (frame_index % 8));
+            }
+            if (mask != 0) {
+                deinterleave_channel<Device>(set, bit_input, channel, mask, bytes, frame);
+            }
+        }
+    }
+
+    /// deinterleave_group packs Device::patterns_per_frame / replicates consecutive raw patterns into a YUV420
+    /// frame. Each raw pattern is displayed replicates times in a row.
+    template <typename Device = lightcrafter_1440_hz>
+    inline void deinterleave_group(
+        instruction_set set,
+        bool bit_input,
+        const uint8_t* bytes,
+        uint8_t* frame,
+        std::size_t replicates = 1) {
+        const std::size_t pattern_size = bit_input ? Device::pixels / 8 : Device::pixels;
+        if (replicates == 1) {
+            for (std::size_t pattern = 0; pattern < Device::patterns_per_frame; ++pattern) {
+                deinterleave_pattern<Device>(set, bit_input, pattern, bytes, frame);
+                bytes += pattern_size;
             }
         } else {
-            for (;;) {
-                std::vector<uint8_t> bytes(608 * 684);
-                std::size_t byte_index = 0;
-                input.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
-                if (input.eof()) {
+            for (std::size_t first = 0; first < Device::patterns_per_frame; first += replicates) {
+                deinterleave_replicated_pattern<Device>(set, bit_input, first, replicates, bytes, frame);
+                bytes += pattern_size;
+            }
+        }
+    }
+
+    /// process_groups reads groups of group_size bytes, converts each one to output_size bytes with
+    /// process(const uint8_t* bytes, uint8_t* output), and writes the outputs in order, each preceded by header.
+    /// If threads is larger than 1, a reader thread and threads workers process groups in parallel, and the
+    /// calling thread writes them in order. All the buffers are allocated before the first read.
+    template <typename Process>
+    inline void process_groups(
+        frame_reader& reader,
+        frame_writer& writer,
+        std::size_t group_size,
+        std::size_t output_size,
+        const std::string& header,
+        std::size_t threads,
+        Process process) {
+        if (threads < 2) {
+            std::vector<uint8_t> bytes(reader.in_place() ? 0 : group_size);
+            std::vector<std::vector<uint8_t>> outputs(1 + writer.retained(), std::vector<uint8_t>(output_size, 0));
+            for (std::size_t index = 0;; ++index) {
+                const auto group_bytes = reader.read(bytes.data(), group_size);
+                if (!group_bytes) {
                     break;
                 }
-                {
-                    std::size_t pixel_index = 608 * 684 * 2;
-                    for (std::size_t y = 0; y < 684 / 2; ++y) {
-                        for (std::size_t x = 0; x < 608; ++x) {
-                            if (bytes[byte_index] > 127) {
-                                frame[pixel_index] |= mask;
-                            } else {
-                                frame[pixel_index] &= (~mask);
-                            }
-                            ++byte_index;
-                            ++pixel_index;
+                auto& output = outputs[index % outputs.size()];
+                process(group_bytes, output.data());
+                writer.write(header, output.data(), output.size());
+            }
+            return;
+        }
+        enum class group_state { empty, read, processed };
+        struct group {
+            std::vector<uint8_t> bytes;
+            const uint8_t* data;
+            std::vector<uint8_t> output;
+            group_state state;
+        };
+        std::vector<group> groups(threads + 2 + writer.retained());
+        for (auto& group : groups) {
+            if (!reader.in_place()) {
+                group.bytes.resize(group_size);
+            }
+            group.data = nullptr;
+            group.output.resize(output_size, 0);
+            group.state = group_state::empty;
+        }
+        std::mutex mutex;
+        std::condition_variable condition_variable;
+        std::size_t groups_read = 0;
+        std::size_t groups_claimed = 0;
+        auto end_of_input = false;
+        auto stopped = false;
+        std::exception_ptr reader_exception;
+        std::thread reader_thread([&]() {
+            try {
+                for (std::size_t index = 0;; ++index) {
+                    auto& group = groups[index % groups.size()];
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        condition_variable.wait(lock, [&]() { return group.state == group_state::empty || stopped; });
+                        if (stopped) {
+                            break;
                         }
-                        pixel_index += 608;
                     }
-                }
-                {
-                    std::size_t pixel_index = 608 * 684 * 2 + 608;
-                    for (std::size_t y = 0; y < 684 / 2; ++y) {
-                        for (std::size_t x = 0; x < 608; ++x) {
-                            if (bytes[byte_index] > 127) {
-                                frame[pixel_index] |= mask;
-                            } else {
-                                frame[pixel_index] &= (~mask);
-                            }
-                            ++byte_index;
-                            ++pixel_index;
-                        }
-                        pixel_index += 608;
+                    const auto group_bytes = reader.read(group.bytes.data(), group_size);
+                    std::unique_lock<std::mutex> lock(mutex);
+                    if (!group_bytes) {
+                        break;
                     }
+                    group.data = group_bytes;
+                    group.state = group_state::read;
+                    ++groups_read;
+                    condition_variable.notify_all();
                 }
-                byte_index = 0;
-                input.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
-                if (input.eof()) {
-                    break;
-                }
-                {
-                    std::size_t pixel_index = 0;
-                    for (std::size_t y = 0; y < 684; ++y) {
-                        for (std::size_t x = 0; x < 608; ++x) {
-                            if (bytes[byte_index] > 127) {
-                                frame[pixel_index] |= mask;
-                            } else {
-                                frame[pixel_index] &= (~mask);
-                            }
-                            ++byte_index;
-                            pixel_index += 2;
-                        }
+            } catch (...) {
+                reader_exception = std::current_exception();
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            end_of_input = true;
+            condition_variable.notify_all();
+        });
+        std::vector<std::thread> workers;
+        for (std::size_t worker_index = 0; worker_index < threads; ++worker_index) {
+            workers.emplace_back([&]() {
+                for (;;) {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    condition_variable.wait(
+                        lock, [&]() { return groups_claimed < groups_read || end_of_input || stopped; });
+                    if (groups_claimed == groups_read || stopped) {
+                        break;
                     }
+                    auto& group = groups[groups_claimed % groups.size()];
+                    ++groups_claimed;
+                    lock.unlock();
+                    process(group.data, group.output.data());
+                    lock.lock();
+                    group.state = group_state::processed;
+                    condition_variable.notify_all();
                 }
-                byte_index = 0;
-                input.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
-                if (input.eof()) {
-                    break;
-                }
+            });
+        }
+        std::exception_ptr writer_exception;
+        try {
+            for (std::size_t index = 0;; ++index) {
+                auto& group = groups[index % groups.size()];
                 {
-                    std::size_t pixel_index = 1;
-                    for (std::size_t y = 0; y < 684; ++y) {
-                        for (std::size_t x = 0; x < 608; ++x) {
-                            if (bytes[byte_index] > 127) {
-                                frame[pixel_index] |= mask;
-                            } else {
-                                frame[pixel_index] &= (~mask);
-                            }
-                            ++byte_index;
-                            pixel_index += 2;
-                        }
+                    std::unique_lock<std::mutex> lock(mutex);
+                    condition_variable.wait(lock, [&]() {
+                        return group.state == group_state::processed || (end_of_input && index == groups_read);
+                    });
+                    if (group.state != group_state::processed) {
+                        break;
                     }
                 }
-                if (frame_index == 21) {
-                    output << "FRAME\n";
-                    output.write(reinterpret_cast<const char*>(frame.data()), frame.size());
-                    frame_index = 0;
-                } else {
-                    frame_index += 3;
+                writer.write(header, group.output.data(), group.output.size());
+                if (index >= writer.retained()) {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    groups[(index - writer.retained()) % groups.size()].state = group_state::empty;
+                    condition_variable.notify_all();
                 }
-                mask = (1 << (frame_index % 8));
             }
+        } catch (...) {
+            writer_exception = std::current_exception();
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stopped = true;
+            condition_variable.notify_all();
+        }
+        reader_thread.join();
+        for (auto& worker : workers) {
+            worker.join();
         }
+        if (writer_exception) {
+            std::rethrow_exception(writer_exception);
+        }
+        if (reader_exception) {
+            std::rethrow_exception(reader_exception);
+        }
+    }
+
+    /// pack_groups reads groups of group_size bytes, converts each one to a YUV420 frame with
+    /// pack(const uint8_t* bytes, uint8_t* frame), and writes the frames as a 60 fps YUV4MPEG2 stream.
+    template <typename Device, typename Pack>
+    inline void
+    pack_groups(frame_reader& reader, frame_writer& writer, std::size_t group_size, std::size_t threads, Pack pack) {
+        writer.write(Device::yuv4mpeg2_header(), nullptr, 0);
+        process_groups(reader, writer, group_size, Device::frame_size, "FRAME\n", threads, pack);
+    }
+
+    /// deinterleave converts a Device::framerate / replicates raw stream to a 60 fps YUV420 stream.
+    /// Each raw pattern is read once and displayed replicates times, hence replicates must divide
+    /// Device::patterns_per_frame.
+    template <typename Device = lightcrafter_1440_hz>
+    inline void deinterleave(
+        frame_reader& reader,
+        frame_writer& writer,
+        bool bit_input,
+        std::size_t threads = 1,
+        instruction_set set = detect_instruction_set(),
+        std::size_t replicates = 1) {
+        if (bit_input && Device::bits_per_pattern != 1) {
+            throw std::logic_error("bit input requires one bit per pattern");
+        }
+        if (replicates == 0 || Device::patterns_per_frame % replicates != 0) {
+            throw std::logic_error("the number of replicates must divide the number of patterns per frame");
+        }
+        pack_groups<Device>(
+            reader,
+            writer,
+            (bit_input ? Device::pixels / 8 : Device::pixels) * (Device::patterns_per_frame / replicates),
+            threads,
+            [=](const uint8_t* bytes, uint8_t* frame) {
+                deinterleave_group<Device>(set, bit_input, bytes, frame, replicates);
+            });
+    }
+
+    /// deinterleave converts a Device::framerate / replicates raw stream to a 60 fps YUV420 stream, using standard
+    /// streams.
+    template <typename Device = lightcrafter_1440_hz>
+    inline void deinterleave(
+        std::istream& input,
+        std::ostream& output,
+        bool bit_input,
+        std::size_t threads = 1,
+        instruction_set set = detect_instruction_set(),
+        std::size_t replicates = 1) {
+        stream_frame_reader reader(input);
+        stream_frame_writer writer(output);
+        deinterleave<Device>(reader, writer, bit_input, threads, set, replicates);
     }
 }
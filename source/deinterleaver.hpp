@@ -0,0 +1,199 @@
+#pragma once
+
+#include "deinterleave.hpp"
+#include <deque>
+#include <memory>
+#include <mutex>
+
+/// hummingbird bundles tools to create and play high framerate videos.
+namespace hummingbird {
+    /// deinterleaver packs raw patterns pushed one at a time into YUV420 frames, without intermediate streams.
+    /// Completed frames are taken from a fixed pool of buffers: pull hands out the oldest completed frame, which
+    /// remains valid until it is given back with release.
+    /// push and push_bits must be called from a single thread, pull and release may be called from another one.
+    class deinterleaver {
+        public:
+        deinterleaver(std::size_t frame_size, std::size_t pool_size) :
+            _frame_size(frame_size),
+            _frames(pool_size),
+            _pulled(pool_size, false),
+            _current(nullptr),
+            _pattern(0) {
+            if (pool_size == 0) {
+                throw std::logic_error("the pool must contain at least one frame");
+            }
+            for (auto& frame : _frames) {
+                frame.resize(_frame_size, 0);
+                _free.push_back(frame.data());
+            }
+        }
+        deinterleaver(const deinterleaver&) = delete;
+        deinterleaver(deinterleaver&&) = default;
+        deinterleaver& operator=(const deinterleaver&) = delete;
+        deinterleaver& operator=(deinterleaver&&) = default;
+        virtual ~deinterleaver() {}
+
+        /// push packs a grey pattern (a level larger than 127 means ON with one bit per pattern).
+        /// If a frame is needed and the pool is empty, the pattern is not packed and false is returned.
+        virtual bool push(const uint8_t* greys) = 0;
+
+        /// push_bits packs a bit pattern (least significant bit first), and requires one bit per pattern.
+        /// If a frame is needed and the pool is empty, the pattern is not packed and false is returned.
+        virtual bool push_bits(const uint8_t* bits) = 0;
+
+        /// pull returns the oldest completed frame, or nullptr if there are none.
+        virtual const uint8_t* pull() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_completed.empty()) {
+                return nullptr;
+            }
+            const auto frame = _completed.front();
+            _completed.pop_front();
+            _pulled[index(frame)] = true;
+            return frame;
+        }
+
+        /// release gives a pulled frame back to the pool.
+        /// Releasing a frame twice, or a frame which was not pulled, throws instead of corrupting the pool.
+        virtual void release(const uint8_t* frame) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            const auto frame_index = index(frame);
+            if (!_pulled[frame_index]) {
+                throw std::logic_error("the released frame is not pulled");
+            }
+            _pulled[frame_index] = false;
+            _free.push_back(_frames[frame_index].data());
+        }
+
+        /// frame_size returns the number of bytes in a frame.
+        std::size_t frame_size() const {
+            return _frame_size;
+        }
+
+        /// pending returns the number of patterns pushed since the last completed frame.
+        std::size_t pending() const {
+            return _pattern;
+        }
+
+        protected:
+        /// index returns the position of a frame in the pool, and throws if the frame does not belong to it.
+        std::size_t index(const uint8_t* frame) const {
+            for (std::size_t frame_index = 0; frame_index < _frames.size(); ++frame_index) {
+                if (_frames[frame_index].data() == frame) {
+                    return frame_index;
+                }
+            }
+            throw std::logic_error("the released frame does not belong to the pool");
+        }
+
+        /// acquire makes sure that a frame is being packed, and returns false if the pool is empty.
+        bool acquire() {
+            if (!_current) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (_free.empty()) {
+                    return false;
+                }
+                _current = _free.back();
+                _free.pop_back();
+            }
+            return true;
+        }
+
+        /// complete makes the packed frame available to pull.
+        void complete() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _completed.push_back(_current);
+            _current = nullptr;
+            _pattern = 0;
+        }
+
+        const std::size_t _frame_size;
+        std::vector<std::vector<uint8_t>> _frames;
+        std::vector<bool> _pulled;
+        std::vector<uint8_t*> _free;
+        std::deque<uint8_t*> _completed;
+        std::mutex _mutex;
+        uint8_t* _current;
+        std::size_t _pattern;
+    };
+
+    /// specialized_deinterleaver packs the patterns of a device, each pushed pattern being displayed replicates
+    /// times in a row.
+    template <typename Device = lightcrafter_1440_hz>
+    class specialized_deinterleaver : public deinterleaver {
+        public:
+        specialized_deinterleaver(
+            std::size_t pool_size = 2,
+            instruction_set set = detect_instruction_set(),
+            std::size_t replicates = 1) :
+            deinterleaver(Device::frame_size, pool_size),
+            _set(set),
+            _replicates(replicates) {
+            if (replicates == 0 || Device::patterns_per_frame % replicates != 0) {
+                throw std::logic_error("the number of replicates must divide the number of patterns per frame");
+            }
+        }
+        specialized_deinterleaver(const specialized_deinterleaver&) = delete;
+        specialized_deinterleaver(specialized_deinterleaver&&) = default;
+        specialized_deinterleaver& operator=(const specialized_deinterleaver&) = delete;
+        specialized_deinterleaver& operator=(specialized_deinterleaver&&) = default;
+        virtual ~specialized_deinterleaver() {}
+
+        virtual bool push(const uint8_t* greys) override {
+            return push_pattern(false, greys);
+        }
+
+        virtual bool push_bits(const uint8_t* bits) override {
+            if (Device::bits_per_pattern != 1) {
+                throw std::logic_error("bit input requires one bit per pattern");
+            }
+            return push_pattern(true, bits);
+        }
+
+        protected:
+        /// push_pattern packs a pattern into the current frame, and completes the frame after the last pattern.
+        bool push_pattern(bool bit_input, const uint8_t* bytes) {
+            if (!acquire()) {
+                return false;
+            }
+            const auto first = _pattern * _replicates;
+            if (_replicates == 1) {
+                deinterleave_pattern<Device>(_set, bit_input, first, bytes, _current);
+            } else {
+                deinterleave_replicated_pattern<Device>(_set, bit_input, first, _replicates, bytes, _current);
+            }
+            ++_pattern;
+            if (_pattern * _replicates == Device::patterns_per_frame) {
+                complete();
+            }
+            return true;
+        }
+
+        const instruction_set _set;
+        const std::size_t _replicates;
+    };
+
+    /// make_deinterleaver creates a deinterleaver for the LightCrafter with the given number of bits per pattern.
+    inline std::unique_ptr<deinterleaver> make_deinterleaver(
+        uint8_t bits_per_pattern,
+        std::size_t replicates = 1,
+        std::size_t pool_size = 2,
+        instruction_set set = detect_instruction_set()) {
+        switch (bits_per_pattern) {
+            case 1:
+                return std::unique_ptr<deinterleaver>(
+                    new specialized_deinterleaver<lightcrafter_1440_hz>(pool_size, set, replicates));
+            case 2:
+                return std::unique_ptr<deinterleaver>(
+                    new specialized_deinterleaver<lightcrafter_720_hz>(pool_size, set, replicates));
+            case 4:
+                return std::unique_ptr<deinterleaver>(
+                    new specialized_deinterleaver<lightcrafter_360_hz>(pool_size, set, replicates));
+            case 8:
+                return std::unique_ptr<deinterleaver>(
+                    new specialized_deinterleaver<lightcrafter_180_hz>(pool_size, set, replicates));
+            default:
+                throw std::logic_error("the number of bits per pattern must be 1, 2, 4 or 8");
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// hummingbird bundles tools to create and play high framerate videos.
+namespace hummingbird {
+    /// device describes the pattern sequence of a DLP controller fed with a 60 Hz, 24 bits RGB stream.
+    /// Each RGB frame holds 24 / bits_per_pattern patterns with 2^bits_per_pattern grey levels.
+    /// The encoded YUV420 frames are twice as wide as the device.
+    template <uint16_t Width, uint16_t Height, uint8_t BitsPerPattern>
+    struct device {
+        static_assert(
+            BitsPerPattern == 1 || BitsPerPattern == 2 || BitsPerPattern == 4 || BitsPerPattern == 8,
+            "the number of bits per pattern must be 1, 2, 4 or 8");
+        static_assert(Width % 32 == 0, "the device width must be a multiple of 32");
+        static_assert(Height % 2 == 0, "the device height must be even");
+
+        /// width is the number of columns of a pattern.
+        static constexpr uint16_t width = Width;
+
+        /// height is the number of rows of a pattern.
+        static constexpr uint16_t height = Height;
+
+        /// bits_per_pattern is the number of bit planes used by each pattern.
+        static constexpr uint8_t bits_per_pattern = BitsPerPattern;
+
+        /// patterns_per_frame is the number of patterns packed in a 60 Hz frame.
+        static constexpr std::size_t patterns_per_frame = 24 / BitsPerPattern;
+
+        /// framerate is the number of patterns displayed per second.
+        static constexpr std::size_t framerate = 60 * patterns_per_frame;
+
+        /// pixels is the number of pixels in a pattern.
+        static constexpr std::size_t pixels = static_cast<std::size_t>(Width) * Height;
+
+        /// frame_size is the number of bytes in a packed YUV420 (or RGB) frame.
+        static constexpr std::size_t frame_size = pixels * 3;
+
+        /// pattern_channel returns the channel written by the given pattern.
+        /// 0 is the blue channel (U and V planes), 1 and 2 are the red and green channels (even and odd Y bytes).
+        static constexpr uint8_t pattern_channel(std::size_t pattern) {
+            return static_cast<uint8_t>(pattern % 3);
+        }
+
+        /// pattern_shift returns the position of the least significant bit written by the given pattern.
+        /// Consecutive pattern triplets are three fields apart, which visits every field since 3 and 8 are coprime.
+        static constexpr uint8_t pattern_shift(std::size_t pattern) {
+            return static_cast<uint8_t>(((pattern / 3) * 3) % (8 / BitsPerPattern) * BitsPerPattern);
+        }
+
+        /// pattern_mask returns the bits written by the given pattern.
+        static constexpr uint8_t pattern_mask(std::size_t pattern) {
+            return static_cast<uint8_t>(((1 << BitsPerPattern) - 1) << pattern_shift(pattern));
+        }
+
+        /// yuv4mpeg2_header returns the YUV4MPEG2 stream header matching the device.
+        static std::string yuv4mpeg2_header() {
+            return std::string("YUV4MPEG2 W") + std::to_string(Width * 2) + " H" + std::to_string(Height)
+                   + " F60:1 Ip C420\n";
+        }
+    };
+
+    template <uint16_t Width, uint16_t Height, uint8_t BitsPerPattern>
+    constexpr uint16_t device<Width, Height, BitsPerPattern>::width;
+    template <uint16_t Width, uint16_t Height, uint8_t BitsPerPattern>
+    constexpr uint16_t device<Width, Height, BitsPerPattern>::height;
+    template <uint16_t Width, uint16_t Height, uint8_t BitsPerPattern>
+    constexpr uint8_t device<Width, Height, BitsPerPattern>::bits_per_pattern;
+    template <uint16_t Width, uint16_t Height, uint8_t BitsPerPattern>
+    constexpr std::size_t device<Width, Height, BitsPerPattern>::patterns_per_frame;
+    template <uint16_t Width, uint16_t Height, uint8_t BitsPerPattern>
+    constexpr std::size_t device<Width, Height, BitsPerPattern>::framerate;
+    template <uint16_t Width, uint16_t Height, uint8_t BitsPerPattern>
+    constexpr std::size_t device<Width, Height, BitsPerPattern>::pixels;
+    template <uint16_t Width, uint16_t Height, uint8_t BitsPerPattern>
+    constexpr std::size_t device<Width, Height, BitsPerPattern>::frame_size;
+
+    /// lightcrafter_1440_hz describes the LightCrafter with binary patterns (the default mode).
+    using lightcrafter_1440_hz = device<608, 684, 1>;
+
+    /// lightcrafter_720_hz describes the LightCrafter with 4 grey levels patterns.
+    using lightcrafter_720_hz = device<608, 684, 2>;
+
+    /// lightcrafter_360_hz describes the LightCrafter with 16 grey levels patterns.
+    using lightcrafter_360_hz = device<608, 684, 4>;
+
+    /// lightcrafter_180_hz describes the LightCrafter with 256 grey levels patterns.
+    using lightcrafter_180_hz = device<608, 684, 8>;
+}
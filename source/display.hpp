@@ -6,6 +6,7 @@
 #include <atomic>
 #include <chrono>
 #include <functional>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <thread>
@@ -14,11 +15,21 @@
 /// hummingbird bundles tools to create and play high framerate videos.
 namespace hummingbird {
     /// frame reprsents a 2D frame with an id.
+    /// The bytes are reference-counted, so that pooled or decoder-owned buffers reach the display without copies.
     struct frame {
-        std::vector<uint8_t> bytes;
+        std::shared_ptr<const uint8_t> bytes;
         std::size_t id;
     };
 
+    /// display_format enumerates the frame layouts accepted by the display. Both layouts have the same size.
+    /// rgb frames hold width x height packed RGB triplets (see interleave).
+    /// i420 frames hold decoded YUV420 planes (2 * width x height Y bytes, followed by the U and V planes), and are
+    /// converted to RGB by the fragment shader with the mapping of interleave.
+    enum class display_format {
+        rgb,
+        i420,
+    };
+
     /// display_event bundles feedback data from the display, sent everytime a frame is swapped.
     struct display_event {
         uint32_t tick;
@@ -48,11 +59,14 @@ namespace hummingbird {
     ///         thread, wait for the function to return, then call *start* or *push*
     ///         from the new one.
     ///     *close* can be called from any thread.
+    /// Pushed frames and clear colors must use the display's format.
+    /// The display releases a frame's bytes as soon as they are uploaded to the GPU.
     class display {
         public:
-        display(uint16_t width, uint16_t height, std::size_t fifo_size) :
+        display(uint16_t width, uint16_t height, std::size_t fifo_size, display_format format = display_format::rgb) :
             _width(width),
             _height(height),
+            _format(format),
             _clear_colors(static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * 3, 0),
             _clear_colors_available(false),
             _head(0),
@@ -63,9 +77,6 @@ namespace hummingbird {
             _window_should_close(false),
             _pause_and_clear_on_empty_fifo(false) {
             _accessing_clear_colors.clear(std::memory_order_release);
-            for (auto& frame : _frames) {
-                frame.bytes.resize(_width * _height * 3);
-            }
         }
         display(const display&) = delete;
         display(display&&) = default;
@@ -80,15 +91,15 @@ namespace hummingbird {
             _started.store(true, std::memory_order_release);
         }
 
-        /// push sends a frame to the display.
-        /// If the frame could not be inserted (FIFO full), false is returned.
+        /// push sends a frame to the display, and takes ownership of bytes on success.
+        /// If the frame could not be inserted (FIFO full), false is returned and bytes is left unchanged.
         /// It must be called by the secondary thread responsible for generating the
         /// frames.
-        virtual bool push(std::vector<uint8_t>& bytes, std::size_t id = 0) {
+        virtual bool push(std::shared_ptr<const uint8_t>& bytes, std::size_t id = 0) {
             const auto current_tail = _tail.load(std::memory_order_relaxed);
             const auto next_tail = (current_tail + 1) % _frames.size();
             if (next_tail != _head.load(std::memory_order_acquire)) {
-                _frames[current_tail].bytes.swap(bytes);
+                _frames[current_tail].bytes = std::move(bytes);
                 _frames[current_tail].id = id;
                 _tail.store(next_tail, std::memory_order_release);
                 return true;
@@ -96,6 +107,19 @@ namespace hummingbird {
             return false;
         }
 
+        /// push sends a frame to the display, and moves bytes to the FIFO on success.
+        /// If the frame could not be inserted (FIFO full), false is returned and bytes is left unchanged.
+        virtual bool push(std::vector<uint8_t>& bytes, std::size_t id = 0) {
+            const auto current_tail = _tail.load(std::memory_order_relaxed);
+            if ((current_tail + 1) % _frames.size() == _head.load(std::memory_order_acquire)) {
+                return false;
+            }
+            const auto owner = std::make_shared<std::vector<uint8_t>>(std::move(bytes));
+            bytes.clear();
+            std::shared_ptr<const uint8_t> shared_bytes(owner, owner->data());
+            return push(shared_bytes, id);
+        }
+
         /// pause_and_clear stops the display, flushes its cache and shows the given
         /// background. It must be called by the secondary thread responsible for
         /// generating the frames.
@@ -139,6 +163,7 @@ namespace hummingbird {
 
         const uint16_t _width;
         const uint16_t _height;
+        const display_format _format;
         std::vector<uint8_t> _clear_colors;
         std::atomic_flag _accessing_clear_colors;
         bool _clear_colors_available;
@@ -161,8 +186,9 @@ namespace hummingbird {
             uint16_t height,
             std::size_t prefer,
             std::size_t fifo_size,
-            HandleEvent handle_event) :
-            display(width, height, fifo_size),
+            HandleEvent handle_event,
+            display_format format = display_format::rgb) :
+            display(width, height, fifo_size, format),
             _windowed(windowed),
             _handle_event(std::forward<HandleEvent>(handle_event)) {
             if (!glfwInit()) {
@@ -269,15 +295,8 @@ namespace hummingbird {
             // compile the fragment shader
             const auto fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
             {
-                const std::string fragment_shader(R""(
-                    #version 330 core
-                    in vec2 uv;
-                    out vec4 color;
-                    uniform sampler2DRect sampler;
-                    void main() {
-                        color = texture(sampler, uv);
-                    }
-                )"");
+                const std::string fragment_shader(
+                    _format == display_format::i420 ? i420_fragment_shader() : rgb_fragment_shader());
                 auto fragment_shader_content = fragment_shader.c_str();
                 auto fragment_shader_size = fragment_shader.size();
                 glShaderSource(
@@ -331,25 +350,31 @@ namespace hummingbird {
             glUniform1f(glGetUniformLocation(program_id, "width"), static_cast<GLfloat>(_width));
             glUniform1f(glGetUniformLocation(program_id, "height"), static_cast<GLfloat>(_height));
 
-            // create the texture
-            GLuint texture_id;
-            glGenTextures(1, &texture_id);
-            glBindTexture(GL_TEXTURE_RECTANGLE, texture_id);
-            std::vector<uint8_t> colors(static_cast<std::size_t>(_width) * static_cast<std::size_t>(_height) * 3, 255);
-            glTexImage2D(GL_TEXTURE_RECTANGLE, 0, GL_RGB, _width, _height, 0, GL_RGB, GL_UNSIGNED_BYTE, colors.data());
-            glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-            glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            // create the textures (i420 frames use a RG texture for the Y plane and a R texture for the U and V planes)
+            if (_format == display_format::i420) {
+                glUniform1i(glGetUniformLocation(program_id, "rg_sampler"), 0);
+                glUniform1i(glGetUniformLocation(program_id, "b_sampler"), 1);
+            }
+            std::array<GLuint, 2> texture_ids;
+            glGenTextures(2, texture_ids.data());
+            for (const auto texture_id : texture_ids) {
+                glBindTexture(GL_TEXTURE_RECTANGLE, texture_id);
+                glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            }
             glBindTexture(GL_TEXTURE_RECTANGLE, 0);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            std::vector<uint8_t> colors(static_cast<std::size_t>(_width) * static_cast<std::size_t>(_height) * 3, 255);
+            upload(texture_ids, colors.data());
+            unbind_textures();
 
-            // start the swap loop
+            // start the swap loop, textures are only uploaded when the displayed frame changes
             for (std::size_t index = 0; index < number_of_initialization_frames; ++index) {
                 glUseProgram(program_id);
-                glBindTexture(GL_TEXTURE_RECTANGLE, texture_id);
-                glTexImage2D(
-                    GL_TEXTURE_RECTANGLE, 0, GL_RGB, _width, _height, 0, GL_RGB, GL_UNSIGNED_BYTE, colors.data());
+                bind_textures(texture_ids);
                 glBindVertexArray(vertex_array_id);
                 glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_INT, 0);
-                glBindTexture(GL_TEXTURE_RECTANGLE, 0);
+                unbind_textures();
                 glBindVertexArray(0);
                 glUseProgram(0);
                 check_opengl_error();
@@ -360,6 +385,8 @@ namespace hummingbird {
             while (!glfwWindowShouldClose(window) && !_window_should_close.load(std::memory_order_acquire)) {
                 auto displayed_frame = false;
                 auto empty_fifo = false;
+                std::shared_ptr<const uint8_t> bytes;
+                const uint8_t* new_bytes = nullptr;
                 std::size_t frame_id = 0;
                 auto local_started = _started.load(std::memory_order_acquire);
                 if (local_started) {
@@ -379,7 +406,8 @@ namespace hummingbird {
                             _started.store(false, std::memory_order_release);
                             local_started = false;
                         } else {
-                            colors.swap(_frames[current_head].bytes);
+                            bytes = std::move(_frames[current_head].bytes);
+                            new_bytes = bytes.get();
                             frame_id = _frames[current_head].id;
                             _head.store((current_head + 1) % _frames.size(), std::memory_order_release);
                             displayed_frame = true;
@@ -392,17 +420,26 @@ namespace hummingbird {
                     if (_clear_colors_available) {
                         _clear_colors_available = false;
                         colors.swap(_clear_colors);
-                        _head.store(_tail.load(std::memory_order_acquire), std::memory_order_release);
+                        new_bytes = colors.data();
+                        const auto tail = _tail.load(std::memory_order_acquire);
+                        for (auto index = _head.load(std::memory_order_relaxed); index != tail;
+                             index = (index + 1) % _frames.size()) {
+                            _frames[index].bytes.reset();
+                        }
+                        _head.store(tail, std::memory_order_release);
                     }
                     _accessing_clear_colors.clear(std::memory_order_release);
                 }
                 glUseProgram(program_id);
-                glBindTexture(GL_TEXTURE_RECTANGLE, texture_id);
-                glTexImage2D(
-                    GL_TEXTURE_RECTANGLE, 0, GL_RGB, _width, _height, 0, GL_RGB, GL_UNSIGNED_BYTE, colors.data());
+                if (new_bytes) {
+                    upload(texture_ids, new_bytes);
+                    bytes.reset();
+                } else {
+                    bind_textures(texture_ids);
+                }
                 glBindVertexArray(vertex_array_id);
                 glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_INT, 0);
-                glBindTexture(GL_TEXTURE_RECTANGLE, 0);
+                unbind_textures();
                 glBindVertexArray(0);
                 glUseProgram(0);
                 check_opengl_error();
@@ -424,7 +461,7 @@ namespace hummingbird {
                     break;
                 }
             }
-            glDeleteTextures(1, &texture_id);
+            glDeleteTextures(2, texture_ids.data());
             glDeleteBuffers(2, vertex_buffer_ids.data());
             glDeleteVertexArrays(1, &vertex_array_id);
             glDeleteProgram(program_id);
@@ -432,6 +469,75 @@ namespace hummingbird {
         }
 
         protected:
+        /// rgb_fragment_shader returns the source of the shader which displays packed RGB frames.
+        static std::string rgb_fragment_shader() {
+            return R""(
+                #version 330 core
+                in vec2 uv;
+                out vec4 color;
+                uniform sampler2DRect sampler;
+                void main() {
+                    color = texture(sampler, uv);
+                }
+            )"";
+        }
+
+        /// i420_fragment_shader returns the source of the shader which converts YUV420 frames to RGB.
+        /// Red and green are read from the Y plane (rg_sampler, two bytes per texel), and blue from the U plane for
+        /// even rows and from the V plane for odd rows (b_sampler, U rows followed by V rows).
+        static std::string i420_fragment_shader() {
+            return R""(
+                #version 330 core
+                in vec2 uv;
+                out vec4 color;
+                uniform sampler2DRect rg_sampler;
+                uniform sampler2DRect b_sampler;
+                uniform float height;
+                void main() {
+                    ivec2 position = ivec2(uv);
+                    int b_row = (position.y % 2) * (int(height) / 2) + position.y / 2;
+                    color = vec4(
+                        texelFetch(rg_sampler, position).rg, texelFetch(b_sampler, ivec2(position.x, b_row)).r, 1.0);
+                }
+            )"";
+        }
+
+        /// bind_textures binds the textures to the units used by the fragment shader.
+        virtual void bind_textures(const std::array<GLuint, 2>& texture_ids) {
+            if (_format == display_format::i420) {
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_RECTANGLE, std::get<1>(texture_ids));
+                glActiveTexture(GL_TEXTURE0);
+            }
+            glBindTexture(GL_TEXTURE_RECTANGLE, std::get<0>(texture_ids));
+        }
+
+        /// upload binds the textures and copies a frame to them.
+        /// The bytes may be released as soon as upload returns.
+        virtual void upload(const std::array<GLuint, 2>& texture_ids, const uint8_t* bytes) {
+            bind_textures(texture_ids);
+            if (_format == display_format::i420) {
+                const auto pixels = static_cast<std::size_t>(_width) * static_cast<std::size_t>(_height);
+                glActiveTexture(GL_TEXTURE1);
+                glTexImage2D(
+                    GL_TEXTURE_RECTANGLE, 0, GL_R8, _width, _height, 0, GL_RED, GL_UNSIGNED_BYTE, bytes + pixels * 2);
+                glActiveTexture(GL_TEXTURE0);
+                glTexImage2D(GL_TEXTURE_RECTANGLE, 0, GL_RG8, _width, _height, 0, GL_RG, GL_UNSIGNED_BYTE, bytes);
+            } else {
+                glTexImage2D(GL_TEXTURE_RECTANGLE, 0, GL_RGB, _width, _height, 0, GL_RGB, GL_UNSIGNED_BYTE, bytes);
+            }
+        }
+
+        /// unbind_textures detaches the textures bound by bind_textures.
+        virtual void unbind_textures() {
+            if (_format == display_format::i420) {
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_RECTANGLE, 0);
+                glActiveTexture(GL_TEXTURE0);
+            }
+            glBindTexture(GL_TEXTURE_RECTANGLE, 0);
+        }
+
         /// check_opengl_error throws if openGL generated an error.
         static void check_opengl_error() {
             switch (glGetError()) {
@@ -487,8 +593,9 @@ namespace hummingbird {
         uint16_t height,
         std::size_t prefer,
         std::size_t fifo_size,
-        HandleEvent handle_event) {
+        HandleEvent handle_event,
+        display_format format = display_format::rgb) {
         return std::unique_ptr<specialized_display<HandleEvent>>(new specialized_display<HandleEvent>(
-            windowed, width, height, prefer, fifo_size, std::forward<HandleEvent>(handle_event)));
+            windowed, width, height, prefer, fifo_size, std::forward<HandleEvent>(handle_event), format));
     }
 }
@@ -0,0 +1,280 @@
+#pragma once
+
+#include "device.hpp"
+#include "io.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+}
+
+/// hummingbird bundles tools to create and play high framerate videos.
+namespace hummingbird {
+    /// check_libav throws if a libav function returned an error.
+    inline void check_libav(int error, const std::string& action) {
+        if (error < 0) {
+            char message[AV_ERROR_MAX_STRING_SIZE] = {0};
+            av_strerror(error, message, sizeof(message));
+            throw std::runtime_error(action + " failed (" + message + ")");
+        }
+    }
+
+    /// encoder losslessly compresses YUV420 frames with libx264 and writes them to a MP4 file.
+    /// It is a drop-in replacement for the pipe 'generate | ffmpeg -c:v libx264 -pix_fmt yuv420p -crf 0'.
+    /// threads sets the number of libx264 threads, 0 keeps the libavcodec default.
+    class encoder : public frame_writer {
+        public:
+        encoder(
+            const std::string& filename,
+            const std::string& preset = "veryslow",
+            uint16_t width = lightcrafter_1440_hz::width * 2,
+            uint16_t height = lightcrafter_1440_hz::height,
+            std::size_t threads = 0) :
+            _width(width),
+            _height(height),
+            _format_context(nullptr),
+            _codec_context(nullptr),
+            _stream(nullptr),
+            _frame(nullptr),
+            _packet(nullptr),
+            _frame_index(0),
+            _closed(false) {
+            try {
+                check(
+                    avformat_alloc_output_context2(&_format_context, nullptr, "mp4", filename.c_str()),
+                    "creating the output context");
+                const auto codec = avcodec_find_encoder_by_name("libx264");
+                if (!codec) {
+                    throw std::runtime_error("libavcodec was built without libx264");
+                }
+                _stream = avformat_new_stream(_format_context, nullptr);
+                _codec_context = avcodec_alloc_context3(codec);
+                _frame = av_frame_alloc();
+                _packet = av_packet_alloc();
+                if (!_stream || !_codec_context || !_frame || !_packet) {
+                    throw std::runtime_error("allocating the encoder failed");
+                }
+                _codec_context->width = _width;
+                _codec_context->height = _height;
+                _codec_context->pix_fmt = AV_PIX_FMT_YUV420P;
+                _codec_context->time_base = AVRational{1, 60};
+                _codec_context->framerate = AVRational{60, 1};
+                if (threads > 0) {
+                    _codec_context->thread_count = static_cast<int>(threads);
+                }
+                if (_format_context->oformat->flags & AVFMT_GLOBALHEADER) {
+                    _codec_context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+                }
+                check(av_opt_set(_codec_context->priv_data, "preset", preset.c_str(), 0), "setting the preset");
+                check(av_opt_set(_codec_context->priv_data, "crf", "0", 0), "setting the CRF");
+                check(avcodec_open2(_codec_context, codec, nullptr), "opening the encoder");
+                check(
+                    avcodec_parameters_from_context(_stream->codecpar, _codec_context),
+                    "setting the stream parameters");
+                _stream->time_base = _codec_context->time_base;
+                _frame->format = _codec_context->pix_fmt;
+                _frame->width = _codec_context->width;
+                _frame->height = _codec_context->height;
+                check(av_frame_get_buffer(_frame, 0), "allocating the frame");
+                check(avio_open(&_format_context->pb, filename.c_str(), AVIO_FLAG_WRITE), "opening the output file");
+                check(avformat_write_header(_format_context, nullptr), "writing the output header");
+            } catch (...) {
+                release();
+                throw;
+            }
+        }
+        encoder(const encoder&) = delete;
+        encoder(encoder&&) = default;
+        encoder& operator=(const encoder&) = delete;
+        encoder& operator=(encoder&&) = default;
+        virtual ~encoder() {
+            try {
+                close();
+            } catch (const std::runtime_error&) {
+            }
+            release();
+        }
+
+        /// write compresses a YUV420 frame.
+        /// Zero-size writes (such as the YUV4MPEG2 stream header) are ignored.
+        virtual void write(const std::string&, const uint8_t* bytes, std::size_t size) override {
+            if (size == 0) {
+                return;
+            }
+            if (size != static_cast<std::size_t>(_width) * _height * 3 / 2) {
+                throw std::logic_error("unexpected encoder frame size");
+            }
+            check(av_frame_make_writable(_frame), "making the frame writable");
+            for (std::size_t y = 0; y < _height; ++y) {
+                std::copy_n(bytes + y * _width, _width, _frame->data[0] + y * _frame->linesize[0]);
+            }
+            bytes += static_cast<std::size_t>(_width) * _height;
+            for (std::size_t plane = 1; plane < 3; ++plane) {
+                for (std::size_t y = 0; y < _height / 2; ++y) {
+                    std::copy_n(
+                        bytes + y * (_width / 2), _width / 2, _frame->data[plane] + y * _frame->linesize[plane]);
+                }
+                bytes += static_cast<std::size_t>(_width / 2) * (_height / 2);
+            }
+            _frame->pts = _frame_index;
+            ++_frame_index;
+            encode(_frame);
+        }
+
+        /// close flushes the encoder and finalizes the MP4 file.
+        /// It is called by the destructor, but errors are only reported by explicit calls.
+        virtual void close() {
+            if (_closed) {
+                return;
+            }
+            _closed = true;
+            encode(nullptr);
+            check(av_write_trailer(_format_context), "writing the output trailer");
+        }
+
+        protected:
+        /// check throws if a libav function returned an error.
+        static void check(int error, const std::string& action) {
+            check_libav(error, action);
+        }
+
+        /// encode sends a frame (or nullptr to flush) to the encoder and muxes the available packets.
+        virtual void encode(AVFrame* frame) {
+            check(avcodec_send_frame(_codec_context, frame), "sending a frame to the encoder");
+            for (;;) {
+                const auto error = avcodec_receive_packet(_codec_context, _packet);
+                if (error == AVERROR(EAGAIN) || error == AVERROR_EOF) {
+                    break;
+                }
+                check(error, "receiving a packet from the encoder");
+                av_packet_rescale_ts(_packet, _codec_context->time_base, _stream->time_base);
+                _packet->stream_index = _stream->index;
+                check(av_interleaved_write_frame(_format_context, _packet), "writing a packet");
+            }
+        }
+
+        /// release frees the libav resources.
+        void release() {
+            av_packet_free(&_packet);
+            av_frame_free(&_frame);
+            avcodec_free_context(&_codec_context);
+            if (_format_context) {
+                if (_format_context->pb) {
+                    avio_closep(&_format_context->pb);
+                }
+                avformat_free_context(_format_context);
+                _format_context = nullptr;
+            }
+        }
+
+        const uint16_t _width;
+        const uint16_t _height;
+        AVFormatContext* _format_context;
+        AVCodecContext* _codec_context;
+        AVStream* _stream;
+        AVFrame* _frame;
+        AVPacket* _packet;
+        int64_t _frame_index;
+        bool _closed;
+    };
+
+    /// concatenate joins MP4 files with identical video streams (for instance written by encoders with the same
+    /// parameters) into a single MP4 file, without re-encoding.
+    /// Each file must start with a key frame, and its timestamps are shifted to follow the previous file.
+    inline void concatenate(const std::vector<std::string>& filenames, const std::string& filename) {
+        if (filenames.empty()) {
+            throw std::logic_error("there are no files to concatenate");
+        }
+        AVFormatContext* output = nullptr;
+        AVFormatContext* input = nullptr;
+        AVPacket* packet = av_packet_alloc();
+        const auto release = [&]() {
+            av_packet_free(&packet);
+            avformat_close_input(&input);
+            if (output) {
+                if (output->pb) {
+                    avio_closep(&output->pb);
+                }
+                avformat_free_context(output);
+                output = nullptr;
+            }
+        };
+        try {
+            if (!packet) {
+                throw std::runtime_error("allocating the packet failed");
+            }
+            AVStream* output_stream = nullptr;
+            int64_t offset = 0;
+            for (const auto& input_filename : filenames) {
+                const auto name = std::string("'") + input_filename + "'";
+                check_libav(avformat_open_input(&input, input_filename.c_str(), nullptr, nullptr), "opening " + name);
+                check_libav(avformat_find_stream_info(input, nullptr), "reading the streams of " + name);
+                const auto index = av_find_best_stream(input, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+                check_libav(index, "finding the video stream of " + name);
+                const auto input_stream = input->streams[index];
+                const auto parameters = input_stream->codecpar;
+                if (!output) {
+                    check_libav(
+                        avformat_alloc_output_context2(&output, nullptr, "mp4", filename.c_str()),
+                        "creating the output context");
+                    output_stream = avformat_new_stream(output, nullptr);
+                    if (!output_stream) {
+                        throw std::runtime_error("allocating the output stream failed");
+                    }
+                    check_libav(
+                        avcodec_parameters_copy(output_stream->codecpar, parameters), "copying the stream parameters");
+                    output_stream->codecpar->codec_tag = 0;
+                    output_stream->time_base = input_stream->time_base;
+                    check_libav(avio_open(&output->pb, filename.c_str(), AVIO_FLAG_WRITE), "opening the output file");
+                    check_libav(avformat_write_header(output, nullptr), "writing the output header");
+                } else if (
+                    parameters->codec_id != output_stream->codecpar->codec_id
+                    || parameters->width != output_stream->codecpar->width
+                    || parameters->height != output_stream->codecpar->height
+                    || parameters->extradata_size != output_stream->codecpar->extradata_size
+                    || !std::equal(
+                        parameters->extradata,
+                        parameters->extradata + parameters->extradata_size,
+                        output_stream->codecpar->extradata)) {
+                    throw std::runtime_error(name + " and the previous files have different stream parameters");
+                }
+                auto end = offset;
+                for (;;) {
+                    const auto error = av_read_frame(input, packet);
+                    if (error == AVERROR_EOF) {
+                        break;
+                    }
+                    check_libav(error, "reading a packet from " + name);
+                    if (packet->stream_index != index) {
+                        av_packet_unref(packet);
+                        continue;
+                    }
+                    av_packet_rescale_ts(packet, input_stream->time_base, output_stream->time_base);
+                    if (packet->pts != AV_NOPTS_VALUE) {
+                        packet->pts += offset;
+                        end = std::max(end, packet->pts + packet->duration);
+                    }
+                    if (packet->dts != AV_NOPTS_VALUE) {
+                        packet->dts += offset;
+                    }
+                    packet->stream_index = output_stream->index;
+                    packet->pos = -1;
+                    check_libav(av_interleaved_write_frame(output, packet), "writing a packet");
+                }
+                offset = end;
+                avformat_close_input(&input);
+            }
+            check_libav(av_write_trailer(output), "writing the output trailer");
+        } catch (...) {
+            release();
+            throw;
+        }
+        release();
+    }
+}
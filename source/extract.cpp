@@ -0,0 +1,152 @@
+#include "../third_party/pontella/source/pontella.hpp"
+#include "extract.hpp"
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+/// extract unpacks the input with the given device, and writes the raw frames or compares them with reference.
+/// framerate must be a multiple of 60 that divides Device::framerate, 0 selects Device::framerate.
+template <typename Device>
+void extract(
+    hummingbird::yuv4mpeg2_frame_reader& reader,
+    hummingbird::frame_reader* reference,
+    bool bit_output,
+    std::size_t framerate,
+    std::size_t threads) {
+    if (framerate == 0) {
+        framerate = Device::framerate;
+    }
+    if (framerate % 60 != 0 || Device::framerate % framerate != 0) {
+        throw std::runtime_error(
+            std::string("the framerate must be a multiple of 60 that divides ") + std::to_string(Device::framerate));
+    }
+    const auto replicates = Device::framerate / framerate;
+    if (reference) {
+        hummingbird::verify_frame_writer writer(
+            *reference,
+            Device::width,
+            Device::pixels,
+            bit_output,
+            Device::bits_per_pattern,
+            Device::patterns_per_frame / replicates);
+        hummingbird::extract<Device>(
+            reader, writer, bit_output, threads, hummingbird::detect_instruction_set(), replicates);
+        writer.close();
+        std::cout << writer.patterns() << " raw frames match the reference" << std::endl;
+    } else {
+        hummingbird::file_descriptor_frame_writer writer(
+            STDOUT_FILENO,
+            (bit_output ? Device::pixels / 8 : Device::pixels) * (Device::patterns_per_frame / replicates));
+        hummingbird::extract<Device>(
+            reader, writer, bit_output, threads, hummingbird::detect_instruction_set(), replicates);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    return pontella::main(
+        {
+            "extract converts a YUV4MPEG2 stream back to 608 x 684 binary or grey frames",
+            "    the app reads a stream encoded by generate (for instance decoded by ffmpeg) from stdin,",
+            "    or from the file given with the option 'input', and writes the raw frames to stdout,",
+            "    or compares them with the raw stream given with the option 'verify'",
+            "Syntax: ./extract [options]",
+            "Available options",
+            "    -d [bits], --depth [bits]            sets the number of bits per pattern",
+            "                                             1 (1440 Hz), 2 (720 Hz), 4 (360 Hz) or 8 (180 Hz)",
+            "                                             defaults to 1, larger values require 'grey'",
+            "    -f [fps], --framerate [fps]          sets the raw framerate, defaults to the depth's framerate",
+            "                                             it must match the value used with generate",
+            "    -g, --grey                           switches the raw mode to grey",
+            "                                             without the flag, frames are 608 * 684 / 8 bytes long",
+            "                                             with the flag, frames are 608 * 684 bytes long",
+            "                                             and each level holds the pattern's bits repeatedly",
+            "                                             (0 or 255 with one bit per pattern)",
+            "    -i [path], --input [path]            reads the YUV4MPEG2 stream from a file instead of stdin",
+            "                                             the file is memory-mapped and read in place",
+            "    -t [threads], --threads [threads]    sets the number of unpacking threads",
+            "                                             defaults to the number of cores",
+            "    -v [path], --verify [path]           compares the raw frames with a raw file instead of",
+            "                                             writing them to stdout, and reports the first mismatch",
+            "                                             grey levels are compared through their 'depth'",
+            "                                             most significant bits",
+            "    -h, --help                           shows this help message",
+        },
+        argc,
+        argv,
+        0,
+        {
+            {"depth", {"d"}},
+            {"framerate", {"f"}},
+            {"input", {"i"}},
+            {"threads", {"t"}},
+            {"verify", {"v"}},
+        },
+        {{"grey", {"g"}}},
+        [](pontella::command command) {
+            std::size_t bits_per_pattern = 1;
+            {
+                const auto name_and_value = command.options.find("depth");
+                if (name_and_value != command.options.end()) {
+                    bits_per_pattern = std::stoull(name_and_value->second);
+                }
+            }
+            std::size_t framerate = 0;
+            {
+                const auto name_and_value = command.options.find("framerate");
+                if (name_and_value != command.options.end()) {
+                    framerate = std::stoull(name_and_value->second);
+                    if (framerate == 0) {
+                        throw std::runtime_error("the framerate must be larger than 0");
+                    }
+                }
+            }
+            std::size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+            {
+                const auto name_and_value = command.options.find("threads");
+                if (name_and_value != command.options.end()) {
+                    threads = std::stoull(name_and_value->second);
+                    if (threads == 0) {
+                        throw std::runtime_error("the number of threads must be larger than 0");
+                    }
+                }
+            }
+            std::unique_ptr<hummingbird::frame_reader> input;
+            {
+                const auto name_and_value = command.options.find("input");
+                if (name_and_value != command.options.end()) {
+                    input.reset(new hummingbird::mapped_frame_reader(name_and_value->second));
+                } else {
+                    input.reset(new hummingbird::file_descriptor_frame_reader(STDIN_FILENO));
+                }
+            }
+            std::unique_ptr<hummingbird::frame_reader> reference;
+            {
+                const auto name_and_value = command.options.find("verify");
+                if (name_and_value != command.options.end()) {
+                    reference.reset(new hummingbird::mapped_frame_reader(name_and_value->second));
+                }
+            }
+            hummingbird::yuv4mpeg2_frame_reader reader(*input);
+            const auto bit_output = command.flags.find("grey") == command.flags.end();
+            switch (bits_per_pattern) {
+                case 1:
+                    extract<hummingbird::lightcrafter_1440_hz>(
+                        reader, reference.get(), bit_output, framerate, threads);
+                    break;
+                case 2:
+                    extract<hummingbird::lightcrafter_720_hz>(reader, reference.get(), bit_output, framerate, threads);
+                    break;
+                case 4:
+                    extract<hummingbird::lightcrafter_360_hz>(reader, reference.get(), bit_output, framerate, threads);
+                    break;
+                case 8:
+                    extract<hummingbird::lightcrafter_180_hz>(reader, reference.get(), bit_output, framerate, threads);
+                    break;
+                default:
+                    throw std::runtime_error("the number of bits per pattern must be 1, 2, 4 or 8");
+            }
+        });
+}
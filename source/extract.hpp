@@ -0,0 +1,528 @@
+#pragma once
+
+#include "deinterleave.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+/// hummingbird bundles tools to create and play high framerate videos.
+namespace hummingbird {
+    /// extract_bits_scalar reads the shift bit of every stride-th pixel, and writes it as packed bits (least
+    /// significant bit first). count must be a multiple of 8.
+    inline void
+    extract_bits_scalar(const uint8_t* pixels, uint8_t* bits, std::size_t count, std::size_t stride, uint8_t shift) {
+        for (std::size_t index = 0; index < count; index += 8) {
+            uint8_t byte = 0;
+            for (std::size_t bit = 0; bit < 8; ++bit) {
+                byte |= static_cast<uint8_t>(((pixels[(index + bit) * stride] >> shift) & 1) << bit);
+            }
+            bits[index / 8] = byte;
+        }
+    }
+
+    /// extract_fields_scalar reads the depth-bit field starting at shift in every stride-th pixel, and writes it as a
+    /// grey level with the field copied to every depth-bit field (0 or 255 if depth is 1).
+    inline void extract_fields_scalar(
+        const uint8_t* pixels,
+        uint8_t* greys,
+        std::size_t count,
+        std::size_t stride,
+        uint8_t shift,
+        uint8_t depth) {
+        for (std::size_t index = 0; index < count; ++index) {
+            greys[index] =
+                replicate_fields_scalar(static_cast<uint8_t>(pixels[index * stride] << (8 - depth - shift)), depth);
+        }
+    }
+
+#if defined(HUMMINGBIRD_X86)
+    /// even_bytes_sse2 returns the even bytes of 32 consecutive bytes.
+    __attribute__((target("sse2"))) inline __m128i even_bytes_sse2(const uint8_t* pixels) {
+        const auto low_bytes = _mm_set1_epi16(0xff);
+        return _mm_packus_epi16(
+            _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels)), low_bytes),
+            _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + 16)), low_bytes));
+    }
+
+    /// extract_bits_sse2 is the SSE2 implementation of extract_bits.
+    __attribute__((target("sse2"))) inline void
+    extract_bits_sse2(const uint8_t* pixels, uint8_t* bits, std::size_t count, uint8_t shift) {
+        const auto left_shift = _mm_cvtsi32_si128(7 - shift);
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            const auto two_bytes = static_cast<uint16_t>(_mm_movemask_epi8(
+                _mm_sll_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + index)), left_shift)));
+            std::memcpy(bits + index / 8, &two_bytes, sizeof(two_bytes));
+        }
+        extract_bits_scalar(pixels + index, bits + index / 8, count - index, 1, shift);
+    }
+
+    /// extract_interleaved_bits_sse2 is the SSE2 implementation of extract_interleaved_bits.
+    __attribute__((target("sse2"))) inline void
+    extract_interleaved_bits_sse2(const uint8_t* pixels, uint8_t* bits, std::size_t count, uint8_t shift) {
+        const auto left_shift = _mm_cvtsi32_si128(7 - shift);
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            const auto two_bytes = static_cast<uint16_t>(
+                _mm_movemask_epi8(_mm_sll_epi16(even_bytes_sse2(pixels + index * 2), left_shift)));
+            std::memcpy(bits + index / 8, &two_bytes, sizeof(two_bytes));
+        }
+        extract_bits_scalar(pixels + index * 2, bits + index / 8, count - index, 2, shift);
+    }
+
+    /// extract_fields_sse2 is the SSE2 implementation of extract_fields.
+    __attribute__((target("sse2"))) inline void
+    extract_fields_sse2(const uint8_t* pixels, uint8_t* greys, std::size_t count, uint8_t shift, uint8_t depth) {
+        const auto left_shift = _mm_cvtsi32_si128(8 - depth - shift);
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(greys + index),
+                replicate_fields_sse2(
+                    _mm_sll_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + index)), left_shift),
+                    depth));
+        }
+        extract_fields_scalar(pixels + index, greys + index, count - index, 1, shift, depth);
+    }
+
+    /// extract_interleaved_fields_sse2 is the SSE2 implementation of extract_interleaved_fields.
+    __attribute__((target("sse2"))) inline void extract_interleaved_fields_sse2(
+        const uint8_t* pixels,
+        uint8_t* greys,
+        std::size_t count,
+        uint8_t shift,
+        uint8_t depth) {
+        const auto left_shift = _mm_cvtsi32_si128(8 - depth - shift);
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(greys + index),
+                replicate_fields_sse2(_mm_sll_epi16(even_bytes_sse2(pixels + index * 2), left_shift), depth));
+        }
+        extract_fields_scalar(pixels + index * 2, greys + index, count - index, 2, shift, depth);
+    }
+
+    /// even_bytes_avx2 returns the even bytes of 64 consecutive bytes.
+    __attribute__((target("avx2"))) inline __m256i even_bytes_avx2(const uint8_t* pixels) {
+        const auto low_bytes = _mm256_set1_epi16(0xff);
+        return _mm256_permute4x64_epi64(
+            _mm256_packus_epi16(
+                _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels)), low_bytes),
+                _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + 32)), low_bytes)),
+            0xd8);
+    }
+
+    /// extract_bits_avx2 is the AVX2 implementation of extract_bits.
+    __attribute__((target("avx2"))) inline void
+    extract_bits_avx2(const uint8_t* pixels, uint8_t* bits, std::size_t count, uint8_t shift) {
+        const auto left_shift = _mm_cvtsi32_si128(7 - shift);
+        std::size_t index = 0;
+        for (; index + 32 <= count; index += 32) {
+            const auto four_bytes = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_sll_epi16(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + index)), left_shift)));
+            std::memcpy(bits + index / 8, &four_bytes, sizeof(four_bytes));
+        }
+        extract_bits_scalar(pixels + index, bits + index / 8, count - index, 1, shift);
+    }
+
+    /// extract_interleaved_bits_avx2 is the AVX2 implementation of extract_interleaved_bits.
+    __attribute__((target("avx2"))) inline void
+    extract_interleaved_bits_avx2(const uint8_t* pixels, uint8_t* bits, std::size_t count, uint8_t shift) {
+        const auto left_shift = _mm_cvtsi32_si128(7 - shift);
+        std::size_t index = 0;
+        for (; index + 32 <= count; index += 32) {
+            const auto four_bytes = static_cast<uint32_t>(
+                _mm256_movemask_epi8(_mm256_sll_epi16(even_bytes_avx2(pixels + index * 2), left_shift)));
+            std::memcpy(bits + index / 8, &four_bytes, sizeof(four_bytes));
+        }
+        extract_bits_scalar(pixels + index * 2, bits + index / 8, count - index, 2, shift);
+    }
+
+    /// extract_fields_avx2 is the AVX2 implementation of extract_fields.
+    __attribute__((target("avx2"))) inline void
+    extract_fields_avx2(const uint8_t* pixels, uint8_t* greys, std::size_t count, uint8_t shift, uint8_t depth) {
+        const auto left_shift = _mm_cvtsi32_si128(8 - depth - shift);
+        std::size_t index = 0;
+        for (; index + 32 <= count; index += 32) {
+            _mm256_storeu_si256(
+                reinterpret_cast<__m256i*>(greys + index),
+                replicate_fields_avx2(
+                    _mm256_sll_epi16(
+                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + index)), left_shift),
+                    depth));
+        }
+        extract_fields_scalar(pixels + index, greys + index, count - index, 1, shift, depth);
+    }
+
+    /// extract_interleaved_fields_avx2 is the AVX2 implementation of extract_interleaved_fields.
+    __attribute__((target("avx2"))) inline void extract_interleaved_fields_avx2(
+        const uint8_t* pixels,
+        uint8_t* greys,
+        std::size_t count,
+        uint8_t shift,
+        uint8_t depth) {
+        const auto left_shift = _mm_cvtsi32_si128(8 - depth - shift);
+        std::size_t index = 0;
+        for (; index + 32 <= count; index += 32) {
+            _mm256_storeu_si256(
+                reinterpret_cast<__m256i*>(greys + index),
+                replicate_fields_avx2(_mm256_sll_epi16(even_bytes_avx2(pixels + index * 2), left_shift), depth));
+        }
+        extract_fields_scalar(pixels + index * 2, greys + index, count - index, 2, shift, depth);
+    }
+#elif defined(HUMMINGBIRD_NEON)
+    /// pack_bits_neon packs the least significant bit of 16 bytes (least significant bit first).
+    inline uint16_t pack_bits_neon(uint8x16_t ons) {
+        const int8_t positions[16] = {0, 1, 2, 3, 4, 5, 6, 7, 0, 1, 2, 3, 4, 5, 6, 7};
+        const auto sums = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(vshlq_u8(ons, vld1q_s8(positions)))));
+        return static_cast<uint16_t>(vgetq_lane_u64(sums, 0) | (vgetq_lane_u64(sums, 1) << 8));
+    }
+
+    /// extract_bits_neon is the NEON implementation of extract_bits.
+    inline void extract_bits_neon(const uint8_t* pixels, uint8_t* bits, std::size_t count, uint8_t shift) {
+        const auto right_shift = vdupq_n_s8(-static_cast<int8_t>(shift));
+        const auto ones = vdupq_n_u8(1);
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            const auto two_bytes = pack_bits_neon(vandq_u8(vshlq_u8(vld1q_u8(pixels + index), right_shift), ones));
+            std::memcpy(bits + index / 8, &two_bytes, sizeof(two_bytes));
+        }
+        extract_bits_scalar(pixels + index, bits + index / 8, count - index, 1, shift);
+    }
+
+    /// extract_interleaved_bits_neon is the NEON implementation of extract_interleaved_bits.
+    inline void extract_interleaved_bits_neon(const uint8_t* pixels, uint8_t* bits, std::size_t count, uint8_t shift) {
+        const auto right_shift = vdupq_n_s8(-static_cast<int8_t>(shift));
+        const auto ones = vdupq_n_u8(1);
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            const auto two_bytes =
+                pack_bits_neon(vandq_u8(vshlq_u8(vld2q_u8(pixels + index * 2).val[0], right_shift), ones));
+            std::memcpy(bits + index / 8, &two_bytes, sizeof(two_bytes));
+        }
+        extract_bits_scalar(pixels + index * 2, bits + index / 8, count - index, 2, shift);
+    }
+
+    /// extract_fields_neon is the NEON implementation of extract_fields.
+    inline void
+    extract_fields_neon(const uint8_t* pixels, uint8_t* greys, std::size_t count, uint8_t shift, uint8_t depth) {
+        const auto left_shift = vdupq_n_s8(static_cast<int8_t>(8 - depth - shift));
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            vst1q_u8(greys + index, replicate_fields_neon(vshlq_u8(vld1q_u8(pixels + index), left_shift), depth));
+        }
+        extract_fields_scalar(pixels + index, greys + index, count - index, 1, shift, depth);
+    }
+
+    /// extract_interleaved_fields_neon is the NEON implementation of extract_interleaved_fields.
+    inline void extract_interleaved_fields_neon(
+        const uint8_t* pixels,
+        uint8_t* greys,
+        std::size_t count,
+        uint8_t shift,
+        uint8_t depth) {
+        const auto left_shift = vdupq_n_s8(static_cast<int8_t>(8 - depth - shift));
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            vst1q_u8(
+                greys + index,
+                replicate_fields_neon(vshlq_u8(vld2q_u8(pixels + index * 2).val[0], left_shift), depth));
+        }
+        extract_fields_scalar(pixels + index * 2, greys + index, count - index, 2, shift, depth);
+    }
+#endif
+
+    /// extract_bits reads the shift bit of consecutive pixels, and writes it as packed bits (least significant bit
+    /// first). It is the inverse of insert_bits. count must be a multiple of 8.
+    inline void extract_bits(
+        instruction_set set,
+        const uint8_t* pixels,
+        uint8_t* bits,
+        std::size_t count,
+        uint8_t shift) {
+        switch (set) {
+#if defined(HUMMINGBIRD_X86)
+            case instruction_set::ssse3:
+            case instruction_set::sse2:
+                extract_bits_sse2(pixels, bits, count, shift);
+                return;
+            case instruction_set::avx2:
+                extract_bits_avx2(pixels, bits, count, shift);
+                return;
+#elif defined(HUMMINGBIRD_NEON)
+            case instruction_set::neon:
+                extract_bits_neon(pixels, bits, count, shift);
+                return;
+#endif
+            default:
+                extract_bits_scalar(pixels, bits, count, 1, shift);
+        }
+    }
+
+    /// extract_interleaved_bits reads the shift bit of every other pixel, and writes it as packed bits (least
+    /// significant bit first). It is the inverse of insert_interleaved_bits. count must be a multiple of 8.
+    inline void extract_interleaved_bits(
+        instruction_set set,
+        const uint8_t* pixels,
+        uint8_t* bits,
+        std::size_t count,
+        uint8_t shift) {
+        switch (set) {
+#if defined(HUMMINGBIRD_X86)
+            case instruction_set::ssse3:
+            case instruction_set::sse2:
+                extract_interleaved_bits_sse2(pixels, bits, count, shift);
+                return;
+            case instruction_set::avx2:
+                extract_interleaved_bits_avx2(pixels, bits, count, shift);
+                return;
+#elif defined(HUMMINGBIRD_NEON)
+            case instruction_set::neon:
+                extract_interleaved_bits_neon(pixels, bits, count, shift);
+                return;
+#endif
+            default:
+                extract_bits_scalar(pixels, bits, count, 2, shift);
+        }
+    }
+
+    /// extract_fields reads the depth-bit field starting at shift in consecutive pixels, and writes it as a grey
+    /// level with the field copied to every depth-bit field. It is the inverse of insert_thresholds (depth 1) and
+    /// insert_fields.
+    inline void extract_fields(
+        instruction_set set,
+        const uint8_t* pixels,
+        uint8_t* greys,
+        std::size_t count,
+        uint8_t shift,
+        uint8_t depth) {
+        switch (set) {
+#if defined(HUMMINGBIRD_X86)
+            case instruction_set::ssse3:
+            case instruction_set::sse2:
+                extract_fields_sse2(pixels, greys, count, shift, depth);
+                return;
+            case instruction_set::avx2:
+                extract_fields_avx2(pixels, greys, count, shift, depth);
+                return;
+#elif defined(HUMMINGBIRD_NEON)
+            case instruction_set::neon:
+                extract_fields_neon(pixels, greys, count, shift, depth);
+                return;
+#endif
+            default:
+                extract_fields_scalar(pixels, greys, count, 1, shift, depth);
+        }
+    }
+
+    /// extract_interleaved_fields reads the depth-bit field starting at shift in every other pixel, and writes it as
+    /// a grey level with the field copied to every depth-bit field. It is the inverse of
+    /// insert_interleaved_thresholds (depth 1) and insert_interleaved_fields.
+    inline void extract_interleaved_fields(
+        instruction_set set,
+        const uint8_t* pixels,
+        uint8_t* greys,
+        std::size_t count,
+        uint8_t shift,
+        uint8_t depth) {
+        switch (set) {
+#if defined(HUMMINGBIRD_X86)
+            case instruction_set::ssse3:
+            case instruction_set::sse2:
+                extract_interleaved_fields_sse2(pixels, greys, count, shift, depth);
+                return;
+            case instruction_set::avx2:
+                extract_interleaved_fields_avx2(pixels, greys, count, shift, depth);
+                return;
+#elif defined(HUMMINGBIRD_NEON)
+            case instruction_set::neon:
+                extract_interleaved_fields_neon(pixels, greys, count, shift, depth);
+                return;
+#endif
+            default:
+                extract_fields_scalar(pixels, greys, count, 2, shift, depth);
+        }
+    }
+
+    /// extract_pattern reads the bit planes of a pattern in a YUV420 frame, and writes them as a raw pattern.
+    /// It is the inverse of deinterleave_pattern. Grey patterns have their field copied to every depth-bit field,
+    /// hence a grey level larger than 127 means ON if Device::bits_per_pattern is 1.
+    template <typename Device>
+    inline void extract_pattern(
+        instruction_set set,
+        bool bit_output,
+        std::size_t pattern,
+        const uint8_t* frame,
+        uint8_t* bytes) {
+        const auto channel = Device::pattern_channel(pattern);
+        const auto shift = Device::pattern_shift(pattern);
+        if (channel == 0) {
+            for (std::size_t y = 0; y < Device::height; ++y) {
+                const auto pixels = frame + Device::pixels * 2
+                                    + ((y % (Device::height / 2)) * 2 + y / (Device::height / 2)) * Device::width;
+                if (bit_output) {
+                    extract_bits(set, pixels, bytes + y * Device::width / 8, Device::width, shift);
+                } else {
+                    extract_fields(
+                        set, pixels, bytes + y * Device::width, Device::width, shift, Device::bits_per_pattern);
+                }
+            }
+        } else if (bit_output) {
+            extract_interleaved_bits(set, frame + (channel - 1), bytes, Device::pixels, shift);
+        } else {
+            extract_interleaved_fields(
+                set, frame + (channel - 1), bytes, Device::pixels, shift, Device::bits_per_pattern);
+        }
+    }
+
+    /// extract_group reads Device::patterns_per_frame / replicates raw patterns from a YUV420 frame.
+    /// It is the inverse of deinterleave_group: only the first pattern of each run of replicates is read.
+    template <typename Device = lightcrafter_1440_hz>
+    inline void extract_group(
+        instruction_set set,
+        bool bit_output,
+        const uint8_t* frame,
+        uint8_t* bytes,
+        std::size_t replicates = 1) {
+        const std::size_t pattern_size = bit_output ? Device::pixels / 8 : Device::pixels;
+        for (std::size_t first = 0; first < Device::patterns_per_frame; first += replicates) {
+            extract_pattern<Device>(set, bit_output, first, frame, bytes);
+            bytes += pattern_size;
+        }
+    }
+
+    /// extract converts a 60 fps YUV4MPEG2 stream to a Device::framerate / replicates raw stream.
+    /// It is the inverse of deinterleave.
+    template <typename Device = lightcrafter_1440_hz>
+    inline void extract(
+        yuv4mpeg2_frame_reader& reader,
+        frame_writer& writer,
+        bool bit_output,
+        std::size_t threads = 1,
+        instruction_set set = detect_instruction_set(),
+        std::size_t replicates = 1) {
+        if (bit_output && Device::bits_per_pattern != 1) {
+            throw std::logic_error("bit output requires one bit per pattern");
+        }
+        if (replicates == 0 || Device::patterns_per_frame % replicates != 0) {
+            throw std::logic_error("the number of replicates must divide the number of patterns per frame");
+        }
+        if (reader.width() != static_cast<std::size_t>(Device::width) * 2 || reader.height() != Device::height) {
+            throw std::runtime_error(
+                std::string("the YUV4MPEG2 frames must be ") + std::to_string(Device::width * 2) + " x "
+                + std::to_string(Device::height) + " pixels");
+        }
+        if (reader.chroma().compare(0, 3, "420") != 0) {
+            throw std::runtime_error("the YUV4MPEG2 frames must use a 420 colour space");
+        }
+        process_groups(
+            reader,
+            writer,
+            Device::frame_size,
+            (bit_output ? Device::pixels / 8 : Device::pixels) * (Device::patterns_per_frame / replicates),
+            std::string(),
+            threads,
+            [=](const uint8_t* frame, uint8_t* bytes) {
+                extract_group<Device>(set, bit_output, frame, bytes, replicates);
+            });
+    }
+
+    /// verify_frame_writer compares raw patterns with a reference raw stream, and throws on the first mismatch.
+    /// Grey reference patterns are compared through their depth most significant bits.
+    class verify_frame_writer : public frame_writer {
+        public:
+        verify_frame_writer(
+            frame_reader& reference,
+            std::size_t width,
+            std::size_t pixels,
+            bool bit_input,
+            uint8_t depth,
+            std::size_t patterns_per_frame,
+            instruction_set set = detect_instruction_set()) :
+            _reference(reference),
+            _width(width),
+            _pattern_size(bit_input ? pixels / 8 : pixels),
+            _bit_input(bit_input),
+            _depth(depth),
+            _patterns_per_frame(patterns_per_frame),
+            _set(set),
+            _patterns(0) {}
+        verify_frame_writer(const verify_frame_writer&) = delete;
+        verify_frame_writer(verify_frame_writer&&) = default;
+        verify_frame_writer& operator=(const verify_frame_writer&) = delete;
+        verify_frame_writer& operator=(verify_frame_writer&&) = default;
+        virtual ~verify_frame_writer() {}
+
+        virtual void write(const std::string&, const uint8_t* bytes, std::size_t size) override {
+            if (size == 0) {
+                return;
+            }
+            _buffer.resize(size);
+            const auto reference = _reference.read(_buffer.data(), size);
+            if (!reference) {
+                throw std::runtime_error(
+                    std::string("the reference stream ends before the raw frame ") + std::to_string(_patterns));
+            }
+            if (!_bit_input) {
+                _normalized.resize(size);
+                extract_fields(_set, reference, _normalized.data(), size, 8 - _depth, _depth);
+            }
+            const auto expected = _bit_input ? reference : _normalized.data();
+            for (std::size_t offset = 0; offset < size; offset += _pattern_size) {
+                if (std::memcmp(expected + offset, bytes + offset, _pattern_size) != 0) {
+                    std::size_t index = 0;
+                    for (; expected[offset + index] == bytes[offset + index]; ++index) {
+                    }
+                    std::size_t pixel = index;
+                    std::string expected_value;
+                    std::string value;
+                    if (_bit_input) {
+                        const auto difference = expected[offset + index] ^ bytes[offset + index];
+                        std::size_t bit = 0;
+                        for (; ((difference >> bit) & 1) == 0; ++bit) {
+                        }
+                        pixel = index * 8 + bit;
+                        expected_value = ((expected[offset + index] >> bit) & 1) ? "ON" : "OFF";
+                        value = ((bytes[offset + index] >> bit) & 1) ? "ON" : "OFF";
+                    } else {
+                        expected_value = std::to_string(expected[offset + index]);
+                        value = std::to_string(bytes[offset + index]);
+                    }
+                    const auto pattern = _patterns + offset / _pattern_size;
+                    throw std::runtime_error(
+                        std::string("mismatch in raw frame ") + std::to_string(pattern) + " (60 Hz frame "
+                        + std::to_string(pattern / _patterns_per_frame) + ") at pixel ("
+                        + std::to_string(pixel % _width) + ", " + std::to_string(pixel / _width) + "): expected "
+                        + expected_value + ", got " + value);
+                }
+            }
+            _patterns += size / _pattern_size;
+        }
+
+        /// close throws if the reference stream has more raw frames than the verified stream.
+        virtual void close() {
+            _buffer.resize(_pattern_size);
+            if (_reference.read(_buffer.data(), _pattern_size)) {
+                throw std::runtime_error(
+                    std::string("the reference stream has more than ") + std::to_string(_patterns) + " raw frames");
+            }
+        }
+
+        /// patterns returns the number of verified raw frames.
+        std::size_t patterns() const {
+            return _patterns;
+        }
+
+        protected:
+        frame_reader& _reference;
+        const std::size_t _width;
+        const std::size_t _pattern_size;
+        const bool _bit_input;
+        const uint8_t _depth;
+        const std::size_t _patterns_per_frame;
+        const instruction_set _set;
+        std::size_t _patterns;
+        std::vector<uint8_t> _buffer;
+        std::vector<uint8_t> _normalized;
+    };
+}
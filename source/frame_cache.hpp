@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <unordered_map>
+#include <vector>
+
+/// hummingbird bundles tools to create and play high framerate videos.
+namespace hummingbird {
+    /// frame_cache keeps the displayed frames of recently played files in memory, within a budget in bytes.
+    /// Files are identified by path, modification time and size, and the least recently used clips are evicted
+    /// first. Clips are shared pointers, hence an evicted clip remains valid until its frames are released.
+    /// frame_cache is not thread-safe.
+    class frame_cache {
+        public:
+        /// clip holds the frames of a file.
+        struct clip {
+            std::string filename;
+            int64_t modification;
+            int64_t size;
+            std::vector<std::vector<uint8_t>> frames;
+
+            /// bytes returns the memory used by the frames.
+            std::size_t bytes() const {
+                std::size_t result = 0;
+                for (const auto& frame : frames) {
+                    result += frame.size();
+                }
+                return result;
+            }
+        };
+
+        /// make_clip creates an empty clip with the current modification time and size of a file.
+        static std::shared_ptr<clip> make_clip(const std::string& filename) {
+            std::shared_ptr<clip> result(new clip{filename, 0, 0, {}});
+            if (!stamp(filename, result->modification, result->size)) {
+                throw std::runtime_error(std::string("'") + filename + "' could not be open for reading");
+            }
+            return result;
+        }
+
+        frame_cache(std::size_t budget) : _budget(budget), _bytes(0) {}
+        frame_cache(const frame_cache&) = delete;
+        frame_cache(frame_cache&&) = default;
+        frame_cache& operator=(const frame_cache&) = delete;
+        frame_cache& operator=(frame_cache&&) = default;
+        virtual ~frame_cache() {}
+
+        /// find returns the clip of a file, or nullptr if the file is not cached or changed since it was cached.
+        virtual std::shared_ptr<const clip> find(const std::string& filename) {
+            const auto filename_and_entry = _filename_to_entry.find(filename);
+            if (filename_and_entry == _filename_to_entry.end()) {
+                return nullptr;
+            }
+            const auto entry = filename_and_entry->second;
+            int64_t modification;
+            int64_t size;
+            if (!stamp(filename, modification, size) || modification != (*entry)->modification
+                || size != (*entry)->size) {
+                erase(entry);
+                return nullptr;
+            }
+            _entries.splice(_entries.begin(), _entries, entry);
+            return *entry;
+        }
+
+        /// insert adds a complete clip, replaces the previous clip of the same file, and evicts the least recently
+        /// used clips until the cache fits in the budget. Clips larger than the budget are ignored.
+        virtual void insert(std::shared_ptr<const clip> new_clip) {
+            const auto new_bytes = new_clip->bytes();
+            if (new_bytes > _budget) {
+                return;
+            }
+            {
+                const auto filename_and_entry = _filename_to_entry.find(new_clip->filename);
+                if (filename_and_entry != _filename_to_entry.end()) {
+                    erase(filename_and_entry->second);
+                }
+            }
+            while (_bytes + new_bytes > _budget) {
+                erase(std::prev(_entries.end()));
+            }
+            _entries.push_front(new_clip);
+            _filename_to_entry[new_clip->filename] = _entries.begin();
+            _bytes += new_bytes;
+        }
+
+        /// budget returns the maximum number of bytes used by the cached frames.
+        std::size_t budget() const {
+            return _budget;
+        }
+
+        /// bytes returns the number of bytes used by the cached frames.
+        std::size_t bytes() const {
+            return _bytes;
+        }
+
+        protected:
+        /// stamp reads the modification time and size of a file, and returns false if the file does not exist.
+        static bool stamp(const std::string& filename, int64_t& modification, int64_t& size) {
+            struct stat status;
+            if (stat(filename.c_str(), &status) != 0) {
+                return false;
+            }
+            modification = static_cast<int64_t>(status.st_mtime);
+            size = static_cast<int64_t>(status.st_size);
+            return true;
+        }
+
+        /// erase removes a clip from the cache.
+        void erase(std::list<std::shared_ptr<const clip>>::iterator entry) {
+            _bytes -= (*entry)->bytes();
+            _filename_to_entry.erase((*entry)->filename);
+            _entries.erase(entry);
+        }
+
+        const std::size_t _budget;
+        std::size_t _bytes;
+        std::list<std::shared_ptr<const clip>> _entries;
+        std::unordered_map<std::string, std::list<std::shared_ptr<const clip>>::iterator> _filename_to_entry;
+    };
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+/// hummingbird bundles tools to create and play high framerate videos.
+namespace hummingbird {
+    /// frame_pool recycles a fixed number of frame buffers.
+    /// acquire hands out a buffer wrapped in a shared pointer, which returns the buffer to the pool when its last
+    /// copy is destroyed (from any thread). The buffers remain valid after the pool is destroyed, until released.
+    class frame_pool {
+        public:
+        frame_pool(std::size_t frame_size, std::size_t size) : _frame_size(frame_size), _state(new state) {
+            if (size == 0) {
+                throw std::logic_error("the pool must contain at least one frame");
+            }
+            _state->buffers.resize(size, std::vector<uint8_t>(_frame_size, 0));
+            for (auto& buffer : _state->buffers) {
+                _state->free.push_back(buffer.data());
+            }
+        }
+        frame_pool(const frame_pool&) = delete;
+        frame_pool(frame_pool&&) = default;
+        frame_pool& operator=(const frame_pool&) = delete;
+        frame_pool& operator=(frame_pool&&) = default;
+        virtual ~frame_pool() {}
+
+        /// acquire returns a free buffer, or nullptr if every buffer is in use.
+        virtual std::shared_ptr<uint8_t> acquire() {
+            std::lock_guard<std::mutex> lock(_state->mutex);
+            if (_state->free.empty()) {
+                return std::shared_ptr<uint8_t>();
+            }
+            const auto buffer = _state->free.back();
+            _state->free.pop_back();
+            const auto pool_state = _state;
+            return std::shared_ptr<uint8_t>(buffer, [pool_state](uint8_t* released_buffer) {
+                std::lock_guard<std::mutex> lock(pool_state->mutex);
+                pool_state->free.push_back(released_buffer);
+            });
+        }
+
+        /// frame_size returns the number of bytes in a buffer.
+        std::size_t frame_size() const {
+            return _frame_size;
+        }
+
+        protected:
+        /// state holds the buffers, and is shared with the handles so that it outlives the pool if needed.
+        struct state {
+            std::mutex mutex;
+            std::vector<std::vector<uint8_t>> buffers;
+            std::vector<uint8_t*> free;
+        };
+
+        const std::size_t _frame_size;
+        std::shared_ptr<state> _state;
+    };
+}
@@ -0,0 +1,338 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
+
+/// hummingbird bundles tools to create and play high framerate videos.
+namespace hummingbird {
+    /// frame_store_format enumerates the layouts of stored frames.
+    enum class frame_store_format : uint32_t {
+        /// rgb frames are packed RGB triplets, as uploaded by the display's rgb format.
+        rgb = 0,
+
+        /// i420 frames are decoded YUV420 planes, as uploaded by the display's i420 format.
+        i420 = 1,
+    };
+
+    /// frame_store_format_name returns the lowercase name of a frame store format.
+    inline const char* frame_store_format_name(frame_store_format format) {
+        switch (format) {
+            case frame_store_format::rgb:
+                return "rgb";
+            case frame_store_format::i420:
+                return "i420";
+        }
+        return "unknown";
+    }
+
+    /// frame_store_alignment is the offset of the first frame and the granularity of the frame stride.
+    /// It matches the page size of common systems, so that each frame starts on a page boundary.
+    const std::size_t frame_store_alignment = 4096;
+
+    /// frame_store_signature starts every frame store.
+    const char frame_store_signature[8] = {'H', 'B', 'F', 'R', 'A', 'M', 'E', 'S'};
+
+    /// frame_store_version is the version of the header layout.
+    const uint32_t frame_store_version = 1;
+
+    /// frame_store_header describes a frame store. It is stored at the beginning of the file, in little endian
+    /// (signature, version, format, width and height on 32 bits, frame size, stride and frames on 64 bits), padded with
+    /// zeros to frame_store_alignment.
+    struct frame_store_header {
+        frame_store_format format;
+        uint32_t width;
+        uint32_t height;
+        uint64_t frame_size;
+        uint64_t stride;
+        uint64_t frames;
+
+        /// encode returns the padded header bytes.
+        std::vector<uint8_t> encode() const {
+            std::vector<uint8_t> bytes(frame_store_alignment, 0);
+            std::copy(std::begin(frame_store_signature), std::end(frame_store_signature), bytes.begin());
+            auto offset = sizeof(frame_store_signature);
+            const auto write = [&](uint64_t value, std::size_t size) {
+                for (std::size_t index = 0; index < size; ++index) {
+                    bytes[offset + index] = static_cast<uint8_t>(value >> (index * 8));
+                }
+                offset += size;
+            };
+            write(frame_store_version, 4);
+            write(static_cast<uint32_t>(format), 4);
+            write(width, 4);
+            write(height, 4);
+            write(frame_size, 8);
+            write(stride, 8);
+            write(frames, 8);
+            return bytes;
+        }
+
+        /// decode parses header bytes, and returns false if they do not start with the signature.
+        /// size must be at least frame_store_alignment.
+        bool decode(const uint8_t* bytes) {
+            if (!std::equal(std::begin(frame_store_signature), std::end(frame_store_signature), bytes)) {
+                return false;
+            }
+            auto offset = sizeof(frame_store_signature);
+            const auto read = [&](std::size_t size) {
+                uint64_t value = 0;
+                for (std::size_t index = 0; index < size; ++index) {
+                    value |= static_cast<uint64_t>(bytes[offset + index]) << (index * 8);
+                }
+                offset += size;
+                return value;
+            };
+            if (read(4) != frame_store_version) {
+                throw std::runtime_error("unsupported frame store version");
+            }
+            format = static_cast<frame_store_format>(read(4));
+            width = static_cast<uint32_t>(read(4));
+            height = static_cast<uint32_t>(read(4));
+            frame_size = read(8);
+            stride = read(8);
+            frames = read(8);
+            return true;
+        }
+    };
+
+    /// is_frame_store returns true if the file starts with the frame store signature.
+    inline bool is_frame_store(const std::string& filename) {
+        const auto file_descriptor = open(filename.c_str(), O_RDONLY);
+        if (file_descriptor < 0) {
+            return false;
+        }
+        char signature[sizeof(frame_store_signature)];
+        const auto bytes_read = ::read(file_descriptor, signature, sizeof(signature));
+        ::close(file_descriptor);
+        return bytes_read == static_cast<ssize_t>(sizeof(signature))
+               && std::equal(std::begin(signature), std::end(signature), std::begin(frame_store_signature));
+    }
+
+    /// frame_store_writer creates a frame store and appends frames to it.
+    /// The number of frames is written in the header by close, hence a store is invalid until it is closed.
+    class frame_store_writer {
+        public:
+        frame_store_writer(
+            const std::string& filename,
+            frame_store_format format,
+            uint32_t width,
+            uint32_t height,
+            std::size_t frame_size) :
+            _filename(filename),
+            _header{format,
+                    width,
+                    height,
+                    frame_size,
+                    (frame_size + frame_store_alignment - 1) / frame_store_alignment * frame_store_alignment,
+                    0},
+            _padding(_header.stride - frame_size, 0) {
+            _file_descriptor = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (_file_descriptor < 0) {
+                throw std::runtime_error(std::string("'") + filename + "' could not be open for writing");
+            }
+            write_header();
+        }
+        frame_store_writer(const frame_store_writer&) = delete;
+        frame_store_writer(frame_store_writer&&) = default;
+        frame_store_writer& operator=(const frame_store_writer&) = delete;
+        frame_store_writer& operator=(frame_store_writer&&) = default;
+        virtual ~frame_store_writer() {
+            if (_file_descriptor >= 0) {
+                ::close(_file_descriptor);
+            }
+        }
+
+        /// write appends a frame, followed by zeros up to the stride.
+        virtual void write(const uint8_t* bytes) {
+            if (_file_descriptor < 0) {
+                throw std::logic_error("the frame store is closed");
+            }
+            iovec vectors[2];
+            vectors[0].iov_base = const_cast<uint8_t*>(bytes);
+            vectors[0].iov_len = static_cast<std::size_t>(_header.frame_size);
+            vectors[1].iov_base = _padding.data();
+            vectors[1].iov_len = _padding.size();
+            auto count = _padding.empty() ? 1 : 2;
+            auto vector = vectors;
+            while (count > 0) {
+                const auto bytes_written = writev(_file_descriptor, vector, count);
+                if (bytes_written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::runtime_error(
+                        std::string("writing '") + _filename + "' failed: " + std::strerror(errno));
+                }
+                auto advance = static_cast<std::size_t>(bytes_written);
+                while (count > 0 && advance >= vector->iov_len) {
+                    advance -= vector->iov_len;
+                    ++vector;
+                    --count;
+                }
+                if (advance > 0) {
+                    vector->iov_base = static_cast<uint8_t*>(vector->iov_base) + advance;
+                    vector->iov_len -= advance;
+                }
+            }
+            ++_header.frames;
+        }
+
+        /// close writes the number of frames in the header and closes the file.
+        virtual void close() {
+            if (_file_descriptor < 0) {
+                return;
+            }
+            if (lseek(_file_descriptor, 0, SEEK_SET) < 0) {
+                throw std::runtime_error(std::string("seeking in '") + _filename + "' failed");
+            }
+            write_header();
+            if (::close(_file_descriptor) < 0) {
+                _file_descriptor = -1;
+                throw std::runtime_error(std::string("closing '") + _filename + "' failed");
+            }
+            _file_descriptor = -1;
+        }
+
+        /// frames returns the number of written frames.
+        std::size_t frames() const {
+            return static_cast<std::size_t>(_header.frames);
+        }
+
+        protected:
+        /// write_header writes the header at the current position.
+        void write_header() {
+            const auto bytes = _header.encode();
+            std::size_t offset = 0;
+            while (offset < bytes.size()) {
+                const auto bytes_written = ::write(_file_descriptor, bytes.data() + offset, bytes.size() - offset);
+                if (bytes_written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::runtime_error(
+                        std::string("writing '") + _filename + "' failed: " + std::strerror(errno));
+                }
+                offset += static_cast<std::size_t>(bytes_written);
+            }
+        }
+
+        const std::string _filename;
+        frame_store_header _header;
+        std::vector<uint8_t> _padding;
+        int _file_descriptor;
+    };
+
+    /// frame_store memory-maps a frame store and reads its frames in place.
+    /// The mapping is advised as sequential, and prefetch asks the kernel to read ahead the frames about to be
+    /// displayed, so that the display does not wait for the disk.
+    class frame_store {
+        public:
+        frame_store(const std::string& filename) : _data(nullptr), _size(0) {
+            const auto file_descriptor = open(filename.c_str(), O_RDONLY);
+            if (file_descriptor < 0) {
+                throw std::runtime_error(std::string("'") + filename + "' could not be open for reading");
+            }
+            struct stat status;
+            if (fstat(file_descriptor, &status) < 0) {
+                ::close(file_descriptor);
+                throw std::runtime_error(std::string("retrieving the size of '") + filename + "' failed");
+            }
+            _size = static_cast<std::size_t>(status.st_size);
+            if (_size < frame_store_alignment) {
+                ::close(file_descriptor);
+                throw std::runtime_error(std::string("'") + filename + "' is not a frame store");
+            }
+            auto data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+            ::close(file_descriptor);
+            if (data == MAP_FAILED) {
+                throw std::runtime_error(std::string("mapping '") + filename + "' failed");
+            }
+            _data = reinterpret_cast<const uint8_t*>(data);
+            madvise(data, _size, MADV_SEQUENTIAL);
+            bool signed_store;
+            try {
+                signed_store = _header.decode(_data);
+            } catch (...) {
+                munmap(data, _size);
+                throw;
+            }
+            if (!signed_store) {
+                munmap(data, _size);
+                throw std::runtime_error(std::string("'") + filename + "' is not a frame store");
+            }
+            if (_header.stride == 0 || _header.stride < _header.frame_size
+                || _header.stride % frame_store_alignment != 0
+                || (_size - frame_store_alignment) / _header.stride < _header.frames) {
+                munmap(data, _size);
+                throw std::runtime_error(std::string("'") + filename + "' is truncated or corrupted");
+            }
+        }
+        frame_store(const frame_store&) = delete;
+        frame_store(frame_store&&) = default;
+        frame_store& operator=(const frame_store&) = delete;
+        frame_store& operator=(frame_store&&) = default;
+        virtual ~frame_store() {
+            if (_data) {
+                munmap(const_cast<uint8_t*>(_data), _size);
+            }
+        }
+
+        /// frame returns the first byte of a frame.
+        const uint8_t* frame(std::size_t index) const {
+            return _data + frame_store_alignment + index * _header.stride;
+        }
+
+        /// prefetch asks the kernel to read count frames starting at index in the background.
+        void prefetch(std::size_t index, std::size_t count) const {
+            if (index >= _header.frames) {
+                return;
+            }
+            if (count > _header.frames - index) {
+                count = static_cast<std::size_t>(_header.frames) - index;
+            }
+            madvise(const_cast<uint8_t*>(frame(index)), count * _header.stride, MADV_WILLNEED);
+        }
+
+        /// format returns the layout of the frames.
+        frame_store_format format() const {
+            return _header.format;
+        }
+
+        /// width returns the number of columns of the display the frames were rendered for.
+        uint32_t width() const {
+            return _header.width;
+        }
+
+        /// height returns the number of rows of the display the frames were rendered for.
+        uint32_t height() const {
+            return _header.height;
+        }
+
+        /// frame_size returns the number of bytes in a frame.
+        std::size_t frame_size() const {
+            return static_cast<std::size_t>(_header.frame_size);
+        }
+
+        /// frames returns the number of frames.
+        std::size_t frames() const {
+            return static_cast<std::size_t>(_header.frames);
+        }
+
+        protected:
+        const uint8_t* _data;
+        std::size_t _size;
+        frame_store_header _header;
+    };
+}
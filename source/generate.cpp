@@ -1,29 +1,340 @@
 #include "../third_party/pontella/source/pontella.hpp"
+#include "bitplanes.hpp"
 #include "deinterleave.hpp"
+#include "incremental_deinterleave.hpp"
+#include "live_ring.hpp"
+#include "sparse_deinterleave.hpp"
+#ifdef HUMMINGBIRD_ENCODER
+#include "chunked_encode.hpp"
+#include "encoder.hpp"
+#endif
+#include <algorithm>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+/// replicates returns the number of times each input frame is displayed.
+/// framerate must be a multiple of 60 that divides Device::framerate, 0 selects Device::framerate.
+template <typename Device>
+std::size_t replicates(std::size_t framerate) {
+    if (framerate == 0) {
+        framerate = Device::framerate;
+    }
+    if (framerate % 60 != 0 || Device::framerate % framerate != 0) {
+        throw std::runtime_error(
+            std::string("the framerate must be a multiple of 60 that divides ") + std::to_string(Device::framerate));
+    }
+    return Device::framerate / framerate;
+}
+
+/// generate packs the input with the given device.
+template <typename Device>
+void generate(
+    hummingbird::frame_reader& reader,
+    hummingbird::frame_writer& writer,
+    bool bit_input,
+    bool sparse,
+    bool incremental,
+    std::size_t framerate,
+    std::size_t threads) {
+    if (sparse) {
+        hummingbird::sparse_deinterleave<Device>(reader, writer, replicates<Device>(framerate));
+    } else if (incremental) {
+        const auto statistics = hummingbird::incremental_deinterleave<Device>(
+            reader, writer, bit_input, hummingbird::detect_instruction_set(), replicates<Device>(framerate));
+        std::cerr << "packed " << statistics.dirty_blocks << " of " << statistics.blocks << " blocks ("
+                  << statistics.dirty_ratio() * 100 << " %)" << std::endl;
+    } else {
+        hummingbird::deinterleave<Device>(
+            reader, writer, bit_input, threads, hummingbird::detect_instruction_set(), replicates<Device>(framerate));
+    }
+}
+
+#ifdef HUMMINGBIRD_ENCODER
+/// generate_chunks packs and encodes the input with the given device, splitting it into chunks encoded in parallel.
+/// The threads are shared among the chunks' encoders.
+template <typename Device>
+void generate_chunks(
+    const hummingbird::mapped_frame_reader& reader,
+    const std::string& filename,
+    const std::string& preset,
+    bool bit_input,
+    std::size_t framerate,
+    std::size_t chunks,
+    std::size_t threads) {
+    hummingbird::chunked_encode<Device>(
+        reader.data(),
+        reader.size(),
+        filename,
+        preset,
+        bit_input,
+        chunks,
+        std::max(threads / chunks, static_cast<std::size_t>(1)),
+        hummingbird::detect_instruction_set(),
+        replicates<Device>(framerate));
+}
+#endif
 
 int main(int argc, char* argv[]) {
     return pontella::main(
         {
-            "generate converts 608 x 684 binary frames to a YUV4MPEG2 stream",
+            "generate converts 608 x 684 binary or grey frames to a YUV4MPEG2 stream",
             "    the app reads a stream of raw 608 * 684 frames from stdin,",
-            "    and writes to stdout",
+            "    or from the file given with the option 'input', and writes to stdout",
+            "    or to the bit-plane video given with the option 'bitplanes'",
+            "    or to the shared-memory live ring given with the option 'ring'",
+#ifdef HUMMINGBIRD_ENCODER
+            "    or to the MP4 file given with the option 'output'",
+#endif
             "Syntax: ./generate [options]",
             "Available options",
-            "    -g , --grey    switches the input mode to grey",
-            "                       without the flag, raw frames must be 608 * "
-            "684 / 8 bytes long",
-            "                       with the flag, raw frames must be 608 * 684 "
-            "bytes long",
-            "                       and a value larger than 127 means ON",
-            "    -h, --help     shows this help message",
+            "    -b [path], --bitplanes [path]        writes the frames to a bit-plane video instead of stdout",
+            "                                             a lossless format read by play without a H.264 decoder,",
+            "                                             frames are XORed with the previous one and compressed",
+            "                                             with LZ77 sequences, with a key frame every second",
+#ifdef HUMMINGBIRD_ENCODER
+            "    -c [chunks], --chunks [chunks]       splits the input into chunks encoded in parallel",
+            "                                             requires 'input' and 'output', each chunk is encoded",
+            "                                             by its own libx264 instance and starts with a key frame",
+            "                                             the chunks are concatenated into the output without",
+            "                                             re-encoding, the decoded frames do not depend on chunks",
+            "                                             'threads' are shared among the chunks",
+#endif
+            "    -d [bits], --depth [bits]            sets the number of bits per pattern",
+            "                                             1 (1440 Hz), 2 (720 Hz), 4 (360 Hz) or 8 (180 Hz)",
+            "                                             defaults to 1, larger values require 'grey' or 'sparse'",
+            "                                             the most significant bits of each grey level are used",
+            "    -f [fps], --framerate [fps]          sets the input framerate, defaults to the depth's framerate",
+            "                                             it must be a multiple of 60 that divides the latter",
+            "                                             each input frame is read once and displayed repeatedly",
+            "    -g, --grey                           switches the input mode to grey",
+            "                                             without the flag, frames must be 608 * 684 / 8 bytes long",
+            "                                             with the flag, frames must be 608 * 684 bytes long",
+            "                                             and a value larger than 127 means ON",
+            "    -i [path], --input [path]            reads the frames from a file instead of stdin",
+            "                                             the file is memory-mapped and read in place",
+#ifdef HUMMINGBIRD_ENCODER
+            "    -o [path], --output [path]           encodes the frames to a MP4 file instead of writing to stdout",
+            "                                             the frames are losslessly compressed with libx264 (CRF 0)",
+            "    -p [preset], --preset [preset]       sets the libx264 preset used with the option 'output'",
+            "                                             defaults to veryslow",
+#endif
+            "    -n, --incremental                    packs only the regions which changed since the previous frame",
+            "                                             the output is identical, static stimuli are packed faster",
+            "                                             packing runs on a single thread, 'threads' is ignored",
+            "                                             a summary of the packed regions is written to stderr",
+            "    -r [name], --ring [name]             writes the frames to a shared-memory ring instead of stdout",
+            "                                             'name' is a POSIX shared memory name (such as /hummingbird)",
+            "                                             read by play with the option 'ring', packing waits",
+            "                                             while the ring is full, the ring is removed on exit",
+            "                                             fails if the ring already exists (see 'replace-ring')",
+            "    -x, --replace-ring                   removes an existing ring with the same name before creating",
+            "                                             the ring, for instance one left by a crashed producer",
+            "    -s, --sparse                         switches the input mode to sparse",
+            "                                             each frame is a little-endian uint32 count",
+            "                                             followed by count ON pixels (little-endian uint16 x and y)",
+            "                                             the other pixels are OFF",
+            "    -t [threads], --threads [threads]    sets the number of packing threads",
+            "                                             defaults to the number of cores",
+            "                                             1 disables the reading and packing pipeline",
+            "    -h, --help                           shows this help message",
         },
         argc,
         argv,
         0,
-        {},
-        {{"grey", {"g"}}},
+        {
+            {"bitplanes", {"b"}},
+#ifdef HUMMINGBIRD_ENCODER
+            {"chunks", {"c"}},
+#endif
+            {"depth", {"d"}},
+            {"framerate", {"f"}},
+            {"input", {"i"}},
+            {"ring", {"r"}},
+#ifdef HUMMINGBIRD_ENCODER
+            {"output", {"o"}},
+            {"preset", {"p"}},
+#endif
+            {"threads", {"t"}},
+        },
+        {{"grey", {"g"}}, {"incremental", {"n"}}, {"replace-ring", {"x"}}, {"sparse", {"s"}}},
         [](pontella::command command) {
-            hummingbird::deinterleave(std::cin, std::cout, command.flags.find("grey") == command.flags.end());
+            std::size_t bits_per_pattern = 1;
+            {
+                const auto name_and_value = command.options.find("depth");
+                if (name_and_value != command.options.end()) {
+                    bits_per_pattern = std::stoull(name_and_value->second);
+                }
+            }
+            std::size_t framerate = 0;
+            {
+                const auto name_and_value = command.options.find("framerate");
+                if (name_and_value != command.options.end()) {
+                    framerate = std::stoull(name_and_value->second);
+                    if (framerate == 0) {
+                        throw std::runtime_error("the framerate must be larger than 0");
+                    }
+                }
+            }
+            std::size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+            {
+                const auto name_and_value = command.options.find("threads");
+                if (name_and_value != command.options.end()) {
+                    threads = std::stoull(name_and_value->second);
+                    if (threads == 0) {
+                        throw std::runtime_error("the number of threads must be larger than 0");
+                    }
+                }
+            }
+            std::unique_ptr<hummingbird::frame_reader> reader;
+            {
+                const auto name_and_value = command.options.find("input");
+                if (name_and_value != command.options.end()) {
+                    reader.reset(new hummingbird::mapped_frame_reader(name_and_value->second));
+                } else {
+                    reader.reset(new hummingbird::file_descriptor_frame_reader(STDIN_FILENO));
+                }
+            }
+            const auto bit_input = command.flags.find("grey") == command.flags.end();
+            const auto sparse = command.flags.find("sparse") != command.flags.end();
+            if (sparse && !bit_input) {
+                throw std::runtime_error("the flags 'grey' and 'sparse' are not compatible");
+            }
+            const auto incremental = command.flags.find("incremental") != command.flags.end();
+            if (sparse && incremental) {
+                throw std::runtime_error("the flags 'incremental' and 'sparse' are not compatible");
+            }
+            std::unique_ptr<hummingbird::frame_writer> writer;
+            const auto bitplanes_name_and_value = command.options.find("bitplanes");
+            const auto ring_name_and_value = command.options.find("ring");
+            if (bitplanes_name_and_value != command.options.end() && ring_name_and_value != command.options.end()) {
+                throw std::runtime_error("the options 'bitplanes' and 'ring' are not compatible");
+            }
+#ifdef HUMMINGBIRD_ENCODER
+            if (bitplanes_name_and_value != command.options.end()
+                && (command.options.find("output") != command.options.end()
+                    || command.options.find("chunks") != command.options.end())) {
+                throw std::runtime_error(
+                    "the option 'bitplanes' is not compatible with the options 'chunks' and 'output'");
+            }
+            if (ring_name_and_value != command.options.end()
+                && (command.options.find("output") != command.options.end()
+                    || command.options.find("chunks") != command.options.end())) {
+                throw std::runtime_error("the option 'ring' is not compatible with the options 'chunks' and 'output'");
+            }
+            std::string preset("veryslow");
+            {
+                const auto name_and_value = command.options.find("preset");
+                if (name_and_value != command.options.end()) {
+                    preset = name_and_value->second;
+                }
+            }
+            {
+                const auto name_and_value = command.options.find("chunks");
+                if (name_and_value != command.options.end()) {
+                    const std::size_t chunks = std::stoull(name_and_value->second);
+                    if (chunks == 0) {
+                        throw std::runtime_error("the number of chunks must be larger than 0");
+                    }
+                    const auto mapped_reader = dynamic_cast<const hummingbird::mapped_frame_reader*>(reader.get());
+                    const auto output_name_and_value = command.options.find("output");
+                    if (!mapped_reader || output_name_and_value == command.options.end()) {
+                        throw std::runtime_error("the option 'chunks' requires the options 'input' and 'output'");
+                    }
+                    if (sparse || incremental) {
+                        throw std::runtime_error(
+                            "the option 'chunks' is not compatible with the flags 'incremental' and 'sparse'");
+                    }
+                    const auto& filename = output_name_and_value->second;
+                    switch (bits_per_pattern) {
+                        case 1:
+                            generate_chunks<hummingbird::lightcrafter_1440_hz>(
+                                *mapped_reader, filename, preset, bit_input, framerate, chunks, threads);
+                            break;
+                        case 2:
+                            generate_chunks<hummingbird::lightcrafter_720_hz>(
+                                *mapped_reader, filename, preset, bit_input, framerate, chunks, threads);
+                            break;
+                        case 4:
+                            generate_chunks<hummingbird::lightcrafter_360_hz>(
+                                *mapped_reader, filename, preset, bit_input, framerate, chunks, threads);
+                            break;
+                        case 8:
+                            generate_chunks<hummingbird::lightcrafter_180_hz>(
+                                *mapped_reader, filename, preset, bit_input, framerate, chunks, threads);
+                            break;
+                        default:
+                            throw std::runtime_error("the number of bits per pattern must be 1, 2, 4 or 8");
+                    }
+                    return;
+                }
+            }
+            hummingbird::encoder* encoder = nullptr;
+            {
+                const auto name_and_value = command.options.find("output");
+                if (name_and_value != command.options.end()) {
+                    encoder = new hummingbird::encoder(name_and_value->second, preset);
+                    writer.reset(encoder);
+                }
+            }
+#endif
+            hummingbird::bitplanes_writer* bitplanes_writer = nullptr;
+            if (bitplanes_name_and_value != command.options.end()) {
+                bitplanes_writer = new hummingbird::bitplanes_writer(
+                    bitplanes_name_and_value->second,
+                    hummingbird::lightcrafter_1440_hz::width,
+                    hummingbird::lightcrafter_1440_hz::height,
+                    hummingbird::lightcrafter_1440_hz::frame_size);
+                writer.reset(bitplanes_writer);
+            }
+            hummingbird::live_ring_writer* live_ring_writer = nullptr;
+            if (ring_name_and_value != command.options.end()) {
+                live_ring_writer = new hummingbird::live_ring_writer(
+                    ring_name_and_value->second,
+                    hummingbird::frame_store_format::i420,
+                    hummingbird::lightcrafter_1440_hz::width,
+                    hummingbird::lightcrafter_1440_hz::height,
+                    hummingbird::lightcrafter_1440_hz::frame_size,
+                    4,
+                    command.flags.find("replace-ring") != command.flags.end());
+                writer.reset(live_ring_writer);
+            }
+            if (!writer) {
+                writer.reset(new hummingbird::file_descriptor_frame_writer(
+                    STDOUT_FILENO, hummingbird::lightcrafter_1440_hz::frame_size));
+            }
+            switch (bits_per_pattern) {
+                case 1:
+                    generate<hummingbird::lightcrafter_1440_hz>(
+                        *reader, *writer, bit_input, sparse, incremental, framerate, threads);
+                    break;
+                case 2:
+                    generate<hummingbird::lightcrafter_720_hz>(
+                        *reader, *writer, bit_input, sparse, incremental, framerate, threads);
+                    break;
+                case 4:
+                    generate<hummingbird::lightcrafter_360_hz>(
+                        *reader, *writer, bit_input, sparse, incremental, framerate, threads);
+                    break;
+                case 8:
+                    generate<hummingbird::lightcrafter_180_hz>(
+                        *reader, *writer, bit_input, sparse, incremental, framerate, threads);
+                    break;
+                default:
+                    throw std::runtime_error("the number of bits per pattern must be 1, 2, 4 or 8");
+            }
+#ifdef HUMMINGBIRD_ENCODER
+            if (encoder) {
+                encoder->close();
+            }
+#endif
+            if (bitplanes_writer) {
+                bitplanes_writer->close();
+            }
+            if (live_ring_writer) {
+                live_ring_writer->close();
+            }
         });
 }
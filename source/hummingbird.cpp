@@ -0,0 +1,169 @@
+#include "hummingbird.h"
+#include "deinterleaver.hpp"
+#include "psychopy.hpp"
+#ifdef HUMMINGBIRD_ENCODER
+#include "encoder.hpp"
+#endif
+#include <exception>
+#include <string>
+
+/// last_error holds the message of the last error raised by a function of this thread.
+static thread_local std::string last_error;
+
+/// guard calls function and converts exceptions to -1 return values.
+template <typename Function>
+static int guard(Function function) {
+    try {
+        function();
+        return 0;
+    } catch (const std::exception& exception) {
+        last_error = exception.what();
+    } catch (...) {
+        last_error = "unknown error";
+    }
+    return -1;
+}
+
+struct hummingbird_encoder {
+#ifdef HUMMINGBIRD_ENCODER
+    hummingbird_encoder(const char* filename, const char* preset) : encoder(filename, preset) {}
+    hummingbird::encoder encoder;
+#endif
+};
+
+struct hummingbird_deinterleaver {
+    hummingbird_deinterleaver(
+        std::unique_ptr<hummingbird::deinterleaver> deinterleaver,
+        hummingbird_frame_callback callback,
+        void* user_data) :
+        deinterleaver(std::move(deinterleaver)),
+        callback(callback),
+        user_data(user_data) {}
+
+    /// push packs a pattern, and passes completed frames to the callback if there is one.
+    int push(bool bit_input, const uint8_t* bytes) {
+        auto pushed = false;
+        const auto result = guard([&]() {
+            pushed = bit_input ? deinterleaver->push_bits(bytes) : deinterleaver->push(bytes);
+            if (callback) {
+                while (const auto frame = deinterleaver->pull()) {
+                    callback(frame, deinterleaver->frame_size(), user_data);
+                    deinterleaver->release(frame);
+                }
+            }
+        });
+        if (result < 0) {
+            return result;
+        }
+        return pushed ? 0 : 1;
+    }
+
+    std::unique_ptr<hummingbird::deinterleaver> deinterleaver;
+    hummingbird_frame_callback callback;
+    void* user_data;
+};
+
+int hummingbird_abi_version(void) {
+    return HUMMINGBIRD_ABI_VERSION;
+}
+
+const char* hummingbird_last_error(void) {
+    return last_error.c_str();
+}
+
+size_t hummingbird_frame_size(void) {
+    return hummingbird::lightcrafter_1440_hz::frame_size;
+}
+
+int hummingbird_psychopy_insert(const uint8_t* greys, size_t stride, uint8_t* frame, size_t pattern) {
+    return guard([&]() { hummingbird::insert_psychopy_pattern(greys, stride, frame, pattern); });
+}
+
+int hummingbird_psychopy_fill_corner(uint8_t* frame, size_t channel, uint8_t value, size_t corner_size) {
+    return guard([&]() {
+        hummingbird::fill_psychopy_corner(frame, static_cast<uint8_t>(channel), value, corner_size);
+    });
+}
+
+int hummingbird_has_encoder(void) {
+#ifdef HUMMINGBIRD_ENCODER
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+hummingbird_encoder* hummingbird_encoder_open(const char* filename, const char* preset) {
+    hummingbird_encoder* encoder = nullptr;
+    guard([&]() {
+#ifdef HUMMINGBIRD_ENCODER
+        encoder = new hummingbird_encoder(filename, preset ? preset : "veryslow");
+#else
+        (void)filename;
+        (void)preset;
+        throw std::runtime_error("the library was built without the encoder");
+#endif
+    });
+    return encoder;
+}
+
+int hummingbird_encoder_write(hummingbird_encoder* encoder, const uint8_t* frame) {
+    return guard([&]() {
+#ifdef HUMMINGBIRD_ENCODER
+        encoder->encoder.write(std::string(), frame, hummingbird::lightcrafter_1440_hz::frame_size);
+#else
+        (void)encoder;
+        (void)frame;
+        throw std::runtime_error("the library was built without the encoder");
+#endif
+    });
+}
+
+int hummingbird_encoder_close(hummingbird_encoder* encoder) {
+    const auto result = guard([&]() {
+#ifdef HUMMINGBIRD_ENCODER
+        encoder->encoder.close();
+#endif
+    });
+    delete encoder;
+    return result;
+}
+
+hummingbird_deinterleaver* hummingbird_deinterleaver_create(
+    size_t bits_per_pattern,
+    size_t replicates,
+    size_t pool_size,
+    hummingbird_frame_callback callback,
+    void* user_data) {
+    hummingbird_deinterleaver* deinterleaver = nullptr;
+    guard([&]() {
+        if (bits_per_pattern > 8) {
+            throw std::logic_error("the number of bits per pattern must be 1, 2, 4 or 8");
+        }
+        deinterleaver = new hummingbird_deinterleaver(
+            hummingbird::make_deinterleaver(static_cast<uint8_t>(bits_per_pattern), replicates, pool_size),
+            callback,
+            user_data);
+    });
+    return deinterleaver;
+}
+
+int hummingbird_deinterleaver_push(hummingbird_deinterleaver* deinterleaver, const uint8_t* greys) {
+    return deinterleaver->push(false, greys);
+}
+
+int hummingbird_deinterleaver_push_bits(hummingbird_deinterleaver* deinterleaver, const uint8_t* bits) {
+    return deinterleaver->push(true, bits);
+}
+
+const uint8_t* hummingbird_deinterleaver_pull(hummingbird_deinterleaver* deinterleaver) {
+    return deinterleaver->deinterleaver->pull();
+}
+
+int hummingbird_deinterleaver_release(hummingbird_deinterleaver* deinterleaver, const uint8_t* frame) {
+    return guard([&]() { deinterleaver->deinterleaver->release(frame); });
+}
+
+void hummingbird_deinterleaver_destroy(hummingbird_deinterleaver* deinterleaver) {
+    delete deinterleaver;
+}
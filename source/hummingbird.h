@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// HUMMINGBIRD_ABI_VERSION is incremented whenever a function signature or behaviour changes incompatibly.
+#define HUMMINGBIRD_ABI_VERSION 1
+
+/// hummingbird_abi_version returns the HUMMINGBIRD_ABI_VERSION the library was built with.
+int hummingbird_abi_version(void);
+
+/// hummingbird_last_error returns the message of the last error raised by a function of this thread.
+const char* hummingbird_last_error(void);
+
+/// hummingbird_frame_size returns the number of bytes in a 1216 x 684 YUV420 frame.
+size_t hummingbird_frame_size(void);
+
+/// hummingbird_psychopy_insert rotates a 343 x 342 grey pattern (rows stride bytes apart), and writes its
+/// thresholds (a grey level larger than 127 means ON) to the bit plane of the given pattern (0 to 23) in a YUV420
+/// frame, with the layout used by psychopy/hummingbird.py. It returns 0 on success and -1 on error.
+int hummingbird_psychopy_insert(const uint8_t* greys, size_t stride, uint8_t* frame, size_t pattern);
+
+/// hummingbird_psychopy_fill_corner sets every bit of a channel's top-right corner triangle to value, with the
+/// layout used by psychopy/hummingbird.py. It returns 0 on success and -1 on error.
+int hummingbird_psychopy_fill_corner(uint8_t* frame, size_t channel, uint8_t value, size_t corner_size);
+
+/// hummingbird_encoder losslessly compresses YUV420 frames to a MP4 file with libx264.
+typedef struct hummingbird_encoder hummingbird_encoder;
+
+/// hummingbird_has_encoder returns 1 if the library was built with libavcodec and libx264, and 0 otherwise.
+int hummingbird_has_encoder(void);
+
+/// hummingbird_encoder_open creates an encoder, and returns NULL on error.
+hummingbird_encoder* hummingbird_encoder_open(const char* filename, const char* preset);
+
+/// hummingbird_encoder_write compresses a 1216 x 684 YUV420 frame. It returns 0 on success and -1 on error.
+int hummingbird_encoder_write(hummingbird_encoder* encoder, const uint8_t* frame);
+
+/// hummingbird_encoder_close flushes the encoder, finalizes the MP4 file and releases the encoder.
+/// It returns 0 on success and -1 on error (the encoder is released in both cases).
+int hummingbird_encoder_close(hummingbird_encoder* encoder);
+
+/// hummingbird_deinterleaver packs 608 x 684 patterns pushed one at a time into YUV420 frames, with the layout
+/// used by generate. Completed frames are taken from a fixed pool of buffers.
+typedef struct hummingbird_deinterleaver hummingbird_deinterleaver;
+
+/// hummingbird_frame_callback receives a completed frame, which is recycled as soon as the callback returns.
+typedef void (*hummingbird_frame_callback)(const uint8_t* frame, size_t size, void* user_data);
+
+/// hummingbird_deinterleaver_create creates a deinterleaver, and returns NULL on error.
+/// bits_per_pattern must be 1, 2, 4 or 8, and replicates (the number of times each pattern is displayed) must
+/// divide the number of patterns per frame (24 / bits_per_pattern).
+/// If callback is not NULL, completed frames are passed to it during push, otherwise they must be pulled.
+hummingbird_deinterleaver* hummingbird_deinterleaver_create(
+    size_t bits_per_pattern,
+    size_t replicates,
+    size_t pool_size,
+    hummingbird_frame_callback callback,
+    void* user_data);
+
+/// hummingbird_deinterleaver_push packs a 608 x 684 grey pattern (a level larger than 127 means ON with one bit
+/// per pattern). It returns 0 on success, 1 if the pool is empty (the pattern was not packed, pull and release
+/// frames before pushing it again) and -1 on error.
+int hummingbird_deinterleaver_push(hummingbird_deinterleaver* deinterleaver, const uint8_t* greys);
+
+/// hummingbird_deinterleaver_push_bits packs a 608 x 684 / 8 bytes bit pattern (least significant bit first),
+/// and requires one bit per pattern. Its return values are the same as hummingbird_deinterleaver_push's.
+int hummingbird_deinterleaver_push_bits(hummingbird_deinterleaver* deinterleaver, const uint8_t* bits);
+
+/// hummingbird_deinterleaver_pull returns the oldest completed frame, or NULL if there are none.
+/// The frame remains valid until it is given back with hummingbird_deinterleaver_release.
+const uint8_t* hummingbird_deinterleaver_pull(hummingbird_deinterleaver* deinterleaver);
+
+/// hummingbird_deinterleaver_release gives a pulled frame back to the pool. It returns 0 on success and -1 on error
+/// (for instance if the frame was not pulled, or was already released).
+int hummingbird_deinterleaver_release(hummingbird_deinterleaver* deinterleaver, const uint8_t* frame);
+
+/// hummingbird_deinterleaver_destroy releases the deinterleaver and its frames.
+void hummingbird_deinterleaver_destroy(hummingbird_deinterleaver* deinterleaver);
+
+#ifdef __cplusplus
+}
+#endif
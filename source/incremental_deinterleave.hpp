@@ -0,0 +1,303 @@
+#pragma once
+
+#include "deinterleave.hpp"
+#include <algorithm>
+#include <cstring>
+
+/// hummingbird bundles tools to create and play high framerate videos.
+namespace hummingbird {
+    /// incremental_block_size is the number of raw bytes compared at once by incremental_deinterleave (one cache
+    /// line, that is 64 pixels in grey mode and 512 pixels in bit mode).
+    constexpr std::size_t incremental_block_size = 64;
+
+    /// incremental_statistics counts the blocks compared by incremental_deinterleave.
+    struct incremental_statistics {
+        /// blocks is the number of compared blocks.
+        std::size_t blocks;
+
+        /// dirty_blocks is the number of blocks which differ from the previous input, and were packed.
+        std::size_t dirty_blocks;
+
+        /// dirty_ratio returns the fraction of dirty blocks.
+        double dirty_ratio() const {
+            return blocks == 0 ? 0.0 : static_cast<double>(dirty_blocks) / blocks;
+        }
+    };
+
+    /// blocks_differ returns true if the given byte blocks differ.
+    inline bool blocks_differ(const uint8_t* first, const uint8_t* second, std::size_t size) {
+        uint64_t difference = 0;
+        std::size_t index = 0;
+        for (; index + 8 <= size; index += 8) {
+            uint64_t first_word;
+            uint64_t second_word;
+            std::memcpy(&first_word, first + index, sizeof(first_word));
+            std::memcpy(&second_word, second + index, sizeof(second_word));
+            difference |= first_word ^ second_word;
+        }
+        for (; index < size; ++index) {
+            difference |= first[index] ^ second[index];
+        }
+        return difference != 0;
+    }
+
+    /// mark_changed_blocks_scalar sets changes[block] to index for every incremental_block_size block which differs
+    /// between bytes and previous_bytes.
+    inline void mark_changed_blocks_scalar(
+        const uint8_t* bytes,
+        const uint8_t* previous_bytes,
+        std::size_t blocks,
+        std::size_t* changes,
+        std::size_t index) {
+        for (std::size_t block = 0; block < blocks; ++block) {
+            if (blocks_differ(
+                    bytes + block * incremental_block_size,
+                    previous_bytes + block * incremental_block_size,
+                    incremental_block_size)) {
+                changes[block] = index;
+            }
+        }
+    }
+
+#if defined(HUMMINGBIRD_X86)
+    /// mark_changed_blocks_sse2 is the SSE2 implementation of mark_changed_blocks.
+    __attribute__((target("sse2"))) inline void mark_changed_blocks_sse2(
+        const uint8_t* bytes,
+        const uint8_t* previous_bytes,
+        std::size_t blocks,
+        std::size_t* changes,
+        std::size_t index) {
+        const auto zeros = _mm_setzero_si128();
+        for (std::size_t block = 0; block < blocks; ++block) {
+            auto difference = zeros;
+            for (std::size_t offset = 0; offset < incremental_block_size; offset += 16) {
+                difference = _mm_or_si128(
+                    difference,
+                    _mm_xor_si128(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + offset)),
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(previous_bytes + offset))));
+            }
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(difference, zeros)) != 0xffff) {
+                changes[block] = index;
+            }
+            bytes += incremental_block_size;
+            previous_bytes += incremental_block_size;
+        }
+    }
+
+    /// mark_changed_blocks_avx2 is the AVX2 implementation of mark_changed_blocks.
+    __attribute__((target("avx2"))) inline void mark_changed_blocks_avx2(
+        const uint8_t* bytes,
+        const uint8_t* previous_bytes,
+        std::size_t blocks,
+        std::size_t* changes,
+        std::size_t index) {
+        for (std::size_t block = 0; block < blocks; ++block) {
+            auto difference = _mm256_setzero_si256();
+            for (std::size_t offset = 0; offset < incremental_block_size; offset += 32) {
+                difference = _mm256_or_si256(
+                    difference,
+                    _mm256_xor_si256(
+                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes + offset)),
+                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(previous_bytes + offset))));
+            }
+            if (!_mm256_testz_si256(difference, difference)) {
+                changes[block] = index;
+            }
+            bytes += incremental_block_size;
+            previous_bytes += incremental_block_size;
+        }
+    }
+#elif defined(HUMMINGBIRD_NEON)
+    /// mark_changed_blocks_neon is the NEON implementation of mark_changed_blocks.
+    inline void mark_changed_blocks_neon(
+        const uint8_t* bytes,
+        const uint8_t* previous_bytes,
+        std::size_t blocks,
+        std::size_t* changes,
+        std::size_t index) {
+        for (std::size_t block = 0; block < blocks; ++block) {
+            auto difference = vdupq_n_u8(0);
+            for (std::size_t offset = 0; offset < incremental_block_size; offset += 16) {
+                difference =
+                    vorrq_u8(difference, veorq_u8(vld1q_u8(bytes + offset), vld1q_u8(previous_bytes + offset)));
+            }
+            const auto halves = vreinterpretq_u64_u8(difference);
+            if ((vgetq_lane_u64(halves, 0) | vgetq_lane_u64(halves, 1)) != 0) {
+                changes[block] = index;
+            }
+            bytes += incremental_block_size;
+            previous_bytes += incremental_block_size;
+        }
+    }
+#endif
+
+    /// mark_changed_blocks sets changes[block] to index for every incremental_block_size block which differs between
+    /// bytes and previous_bytes.
+    inline void mark_changed_blocks(
+        instruction_set set,
+        const uint8_t* bytes,
+        const uint8_t* previous_bytes,
+        std::size_t blocks,
+        std::size_t* changes,
+        std::size_t index) {
+        switch (set) {
+#if defined(HUMMINGBIRD_X86)
+            case instruction_set::ssse3:
+            case instruction_set::sse2:
+                mark_changed_blocks_sse2(bytes, previous_bytes, blocks, changes, index);
+                return;
+            case instruction_set::avx2:
+                mark_changed_blocks_avx2(bytes, previous_bytes, blocks, changes, index);
+                return;
+#elif defined(HUMMINGBIRD_NEON)
+            case instruction_set::neon:
+                mark_changed_blocks_neon(bytes, previous_bytes, blocks, changes, index);
+                return;
+#endif
+            default:
+                mark_changed_blocks_scalar(bytes, previous_bytes, blocks, changes, index);
+        }
+    }
+
+    /// incremental_deinterleave_group packs Device::patterns_per_frame / replicates consecutive raw patterns into a
+    /// YUV420 frame which holds the raw patterns of an earlier group.
+    /// Raw patterns are numbered from 1 in the stream: index is the number of the first raw pattern in bytes, and
+    /// first_index the number of the first raw pattern held by the frame (0 if the frame holds no patterns).
+    /// Each raw pattern is compared with the one before it (previous_bytes for the first one, nullptr if there is
+    /// none) to update the number of the last change of every block, stored in changes. Only the blocks which
+    /// changed since the frame was packed are packed again.
+    template <typename Device = lightcrafter_1440_hz>
+    inline void incremental_deinterleave_group(
+        instruction_set set,
+        bool bit_input,
+        const uint8_t* bytes,
+        const uint8_t* previous_bytes,
+        uint8_t* frame,
+        std::size_t index,
+        std::size_t first_index,
+        std::vector<std::size_t>& changes,
+        std::vector<uint8_t>& dirty,
+        incremental_statistics& statistics,
+        std::size_t replicates = 1) {
+        const std::size_t pattern_size = bit_input ? Device::pixels / 8 : Device::pixels;
+        const std::size_t block_pixels = bit_input ? incremental_block_size * 8 : incremental_block_size;
+        const std::size_t full_blocks = pattern_size / incremental_block_size;
+        const std::size_t blocks = (pattern_size + incremental_block_size - 1) / incremental_block_size;
+        changes.resize(blocks, 0);
+        dirty.resize(blocks);
+        for (std::size_t first = 0; first < Device::patterns_per_frame; first += replicates) {
+            if (previous_bytes) {
+                mark_changed_blocks(set, bytes, previous_bytes, full_blocks, changes.data(), index);
+                if (full_blocks < blocks
+                    && blocks_differ(
+                        bytes + full_blocks * incremental_block_size,
+                        previous_bytes + full_blocks * incremental_block_size,
+                        pattern_size - full_blocks * incremental_block_size)) {
+                    changes[full_blocks] = index;
+                }
+            } else {
+                std::fill(changes.begin(), changes.end(), index);
+            }
+            std::size_t dirty_blocks = 0;
+            for (std::size_t block = 0; block < blocks; ++block) {
+                dirty[block] = first_index == 0 || changes[block] > first_index;
+                dirty_blocks += dirty[block];
+            }
+            statistics.blocks += blocks;
+            statistics.dirty_blocks += dirty_blocks;
+            if (dirty_blocks > 0) {
+                for (uint8_t channel = 0; channel < 3; ++channel) {
+                    uint8_t mask = 0;
+                    for (auto pattern = first; pattern < first + replicates; ++pattern) {
+                        if (Device::pattern_channel(pattern) == channel) {
+                            mask |= Device::pattern_mask(pattern);
+                        }
+                    }
+                    if (mask == 0) {
+                        continue;
+                    }
+                    for (std::size_t block = 0; block < blocks;) {
+                        if (!dirty[block]) {
+                            ++block;
+                            continue;
+                        }
+                        auto run_first = block * block_pixels;
+                        for (; block < blocks && dirty[block]; ++block) {
+                        }
+                        const auto run_end = std::min(block * block_pixels, Device::pixels);
+                        if (channel == 0) {
+                            while (run_first < run_end) {
+                                const auto row_end = std::min((run_first / Device::width + 1) * Device::width, run_end);
+                                deinterleave_pixels<Device>(
+                                    set, bit_input, channel, mask, bytes, frame, run_first, row_end - run_first);
+                                run_first = row_end;
+                            }
+                        } else {
+                            deinterleave_pixels<Device>(
+                                set, bit_input, channel, mask, bytes, frame, run_first, run_end - run_first);
+                        }
+                    }
+                }
+            }
+            previous_bytes = bytes;
+            bytes += pattern_size;
+            ++index;
+            if (first_index > 0) {
+                ++first_index;
+            }
+        }
+    }
+
+    /// incremental_deinterleave converts a Device::framerate / replicates raw stream to a 60 fps YUV420 stream,
+    /// like deinterleave. Each raw pattern is compared block by block with the previous one, and only the blocks
+    /// which changed since an output buffer was last packed are packed again. The output does not depend on the
+    /// comparison. Stimuli which hold frames or change small regions are packed faster.
+    template <typename Device = lightcrafter_1440_hz>
+    inline incremental_statistics incremental_deinterleave(
+        frame_reader& reader,
+        frame_writer& writer,
+        bool bit_input,
+        instruction_set set = detect_instruction_set(),
+        std::size_t replicates = 1) {
+        if (bit_input && Device::bits_per_pattern != 1) {
+            throw std::logic_error("bit input requires one bit per pattern");
+        }
+        if (replicates == 0 || Device::patterns_per_frame % replicates != 0) {
+            throw std::logic_error("the number of replicates must divide the number of patterns per frame");
+        }
+        const std::size_t pattern_size = bit_input ? Device::pixels / 8 : Device::pixels;
+        const std::size_t patterns_per_group = Device::patterns_per_frame / replicates;
+        const std::string frame_header("FRAME\n");
+        writer.write(Device::yuv4mpeg2_header(), nullptr, 0);
+        std::vector<std::vector<uint8_t>> frames(1 + writer.retained(), std::vector<uint8_t>(Device::frame_size, 0));
+        std::vector<std::vector<uint8_t>> groups_bytes(
+            2, std::vector<uint8_t>(reader.in_place() ? 0 : pattern_size * patterns_per_group));
+        std::vector<std::size_t> changes;
+        std::vector<uint8_t> dirty;
+        incremental_statistics statistics{0, 0};
+        const uint8_t* previous_bytes = nullptr;
+        for (std::size_t index = 0;; ++index) {
+            const auto bytes = reader.read(groups_bytes[index % 2].data(), pattern_size * patterns_per_group);
+            if (!bytes) {
+                break;
+            }
+            auto& frame = frames[index % frames.size()];
+            incremental_deinterleave_group<Device>(
+                set,
+                bit_input,
+                bytes,
+                previous_bytes,
+                frame.data(),
+                index * patterns_per_group + 1,
+                index < frames.size() ? 0 : (index - frames.size()) * patterns_per_group + 1,
+                changes,
+                dirty,
+                statistics,
+                replicates);
+            previous_bytes = bytes + pattern_size * (patterns_per_group - 1);
+            writer.write(frame_header, frame.data(), frame.size());
+        }
+        return statistics;
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HUMMINGBIRD_X86
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HUMMINGBIRD_NEON
+#endif
+
+/// hummingbird bundles tools to create and play high framerate videos.
+namespace hummingbird {
+    /// instruction_set enumerates the vector extensions used by the kernels.
+    /// Every kernel provides a scalar implementation with identical results.
+    /// On x86, each set includes the previous ones (sse2, ssse3, avx2): kernels without an implementation for a set
+    /// run their implementation for the largest included set.
+    enum class instruction_set {
+        scalar,
+        sse2,
+        ssse3,
+        avx2,
+        neon,
+    };
+
+    /// detect_instruction_set returns the most efficient instruction set supported by the processor.
+    inline instruction_set detect_instruction_set() {
+#if defined(HUMMINGBIRD_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return instruction_set::avx2;
+        }
+        if (__builtin_cpu_supports("ssse3")) {
+            return instruction_set::ssse3;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return instruction_set::sse2;
+        }
+#elif defined(HUMMINGBIRD_NEON)
+        return instruction_set::neon;
+#endif
+        return instruction_set::scalar;
+    }
+
+    /// instruction_set_name returns the lowercase name of an instruction set.
+    inline const char* instruction_set_name(instruction_set set) {
+        switch (set) {
+            case instruction_set::scalar:
+                return "scalar";
+            case instruction_set::sse2:
+                return "sse2";
+            case instruction_set::ssse3:
+                return "ssse3";
+            case instruction_set::avx2:
+                return "avx2";
+            case instruction_set::neon:
+                return "neon";
+        }
+        return "unknown";
+    }
+
+    /// supported_instruction_sets returns every instruction set supported by the processor, scalar first.
+    inline std::vector<instruction_set> supported_instruction_sets() {
+        std::vector<instruction_set> sets{instruction_set::scalar};
+        switch (detect_instruction_set()) {
+            case instruction_set::avx2:
+                sets.push_back(instruction_set::sse2);
+                sets.push_back(instruction_set::ssse3);
+                sets.push_back(instruction_set::avx2);
+                break;
+            case instruction_set::ssse3:
+                sets.push_back(instruction_set::sse2);
+                sets.push_back(instruction_set::ssse3);
+                break;
+            case instruction_set::sse2:
+                sets.push_back(instruction_set::sse2);
+                break;
+            case instruction_set::neon:
+                sets.push_back(instruction_set::neon);
+                break;
+            default:
+                break;
+        }
+        return sets;
+    }
+}
@@ -1,37 +1,182 @@
 #pragma once
 
+#include "device.hpp"
+#include "instruction_set.hpp"
 #include <cstdint>
-#include <gstreamermm/buffer.h>
-#include <vector>
+#include <cstring>
+#include <utility>
 
 /// hummingbird bundles tools to create and play high framerate videos.
 namespace hummingbird {
-    /// interleave converts a decoded YUV420 buffer to RGB bytes.
-    inline void interleave(const Glib::RefPtr<Gst::Buffer>& buffer, std::vector<uint8_t>& bytes) {
-        if (buffer->get_size() != 608 * 684 * 3) {
-            throw std::logic_error("unexpected buffer size");
-        }
-        bytes.resize(buffer->get_size());
-        auto memory = buffer->peek_memory(0);
-        Gst::MapInfo info;
-        if (!gst_memory_map(memory->gobj(), info.gobj(), GST_MAP_READ)) {
-            throw std::logic_error("mapping the buffer memory failed");
-        }
-        uint16_t* rgs = reinterpret_cast<uint16_t*>(info.get_data());
-        uint8_t* active_b = reinterpret_cast<uint8_t*>(rgs) + ((608 * 2) * 684);
-        uint8_t* idle_b = reinterpret_cast<uint8_t*>(active_b) + ((608 * 2) * 684 / 4);
-        uint8_t* rgbs = bytes.data();
-        for (std::size_t y = 0; y < 684; ++y) {
-            for (std::size_t x = 0; x < 608; ++x) {
-                *reinterpret_cast<uint16_t*>(rgbs) = *rgs;
-                ++rgs;
-                rgbs += 2;
-                *rgbs = *active_b;
-                ++active_b;
-                ++rgbs;
+    /// interleave_row_scalar merges count red-green pairs and count blue bytes into packed RGB triplets.
+    /// It is the reference implementation of the vector kernels.
+    inline void interleave_row_scalar(const uint8_t* rgs, const uint8_t* bs, uint8_t* rgbs, std::size_t count) {
+        for (std::size_t index = 0; index < count; ++index) {
+            std::memcpy(rgbs, rgs, 2);
+            rgs += 2;
+            rgbs[2] = *bs;
+            ++bs;
+            rgbs += 3;
+        }
+    }
+
+#if defined(HUMMINGBIRD_X86)
+    /// interleave_rg_mask returns the pshufb mask which moves red-green bytes to an output chunk (see
+    /// interleave_chunk_ssse3).
+    inline const uint8_t* interleave_rg_mask(std::size_t chunk) {
+        static const int8_t masks[3][16] = {
+            {0, 1, -128, 2, 3, -128, 4, 5, -128, 6, 7, -128, 8, 9, -128, 10},
+            {1, -128, 2, 3, -128, 4, 5, -128, 6, 7, -128, 8, 9, -128, 10, 11},
+            {-128, 2, 3, -128, 4, 5, -128, 6, 7, -128, 8, 9, -128, 10, 11, -128},
+        };
+        return reinterpret_cast<const uint8_t*>(masks[chunk]);
+    }
+
+    /// interleave_b_mask returns the pshufb mask which moves blue bytes to an output chunk (see
+    /// interleave_chunk_ssse3).
+    inline const uint8_t* interleave_b_mask(std::size_t chunk) {
+        static const int8_t masks[3][16] = {
+            {-128, -128, 0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128},
+            {-128, 0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128, -128},
+            {0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128, -128, 5},
+        };
+        return reinterpret_cast<const uint8_t*>(masks[chunk]);
+    }
+
+    /// interleave_chunk_ssse3 returns the 16 RGB bytes which start at byte 16 * chunk of a 48-byte output block.
+    /// The chunk's pixels start at pixel floor(16 * chunk / 3) = 0, 5 or 10, and rgs and bs point to that pixel.
+    /// The red-green source spans 12 bytes and the blue source 6 bytes, but both are read as 16-byte windows.
+    __attribute__((target("ssse3"))) inline __m128i
+    interleave_chunk_ssse3(const uint8_t* rgs, const uint8_t* bs, std::size_t chunk) {
+        return _mm_or_si128(
+            _mm_shuffle_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgs)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(interleave_rg_mask(chunk)))),
+            _mm_shuffle_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(bs)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(interleave_b_mask(chunk)))));
+    }
+
+    /// interleave_row_ssse3 is the SSSE3 version of interleave_row_scalar (16 pixels per iteration).
+    /// The windows read up to 10 pixels past a block, hence the last pixels are handled by the scalar loop.
+    __attribute__((target("ssse3"))) inline void
+    interleave_row_ssse3(const uint8_t* rgs, const uint8_t* bs, uint8_t* rgbs, std::size_t count) {
+        std::size_t index = 0;
+        for (; index + 32 <= count; index += 16) {
+            for (std::size_t chunk = 0; chunk < 3; ++chunk) {
+                const auto first = chunk * 16 / 3;
+                _mm_storeu_si128(
+                    reinterpret_cast<__m128i*>(rgbs + index * 3 + chunk * 16),
+                    interleave_chunk_ssse3(rgs + (index + first) * 2, bs + index + first, chunk));
+            }
+        }
+        interleave_row_scalar(rgs + index * 2, bs + index, rgbs + index * 3, count - index);
+    }
+
+    /// load_pair_avx2 loads 16 bytes from low and 16 bytes from high into the lanes of a 256-bit vector.
+    __attribute__((target("avx2"))) inline __m256i load_pair_avx2(const uint8_t* low, const uint8_t* high) {
+        return _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(low))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(high)),
+            1);
+    }
+
+    /// interleave_row_avx2 is the AVX2 version of interleave_row_scalar (32 pixels per iteration).
+    /// Each 256-bit output holds two consecutive 16-byte chunks, whose windows are loaded in separate lanes since
+    /// pshufb does not cross lanes.
+    __attribute__((target("avx2"))) inline void
+    interleave_row_avx2(const uint8_t* rgs, const uint8_t* bs, uint8_t* rgbs, std::size_t count) {
+        __m256i rg_pair_masks[3];
+        __m256i b_pair_masks[3];
+        for (std::size_t pair = 0; pair < 3; ++pair) {
+            rg_pair_masks[pair] =
+                load_pair_avx2(interleave_rg_mask((pair * 2) % 3), interleave_rg_mask((pair * 2 + 1) % 3));
+            b_pair_masks[pair] =
+                load_pair_avx2(interleave_b_mask((pair * 2) % 3), interleave_b_mask((pair * 2 + 1) % 3));
+        }
+        std::size_t index = 0;
+        for (; index + 48 <= count; index += 32) {
+            for (std::size_t pair = 0; pair < 3; ++pair) {
+                const auto low_first = index + (pair * 2) * 16 / 3;
+                const auto high_first = index + (pair * 2 + 1) * 16 / 3;
+                _mm256_storeu_si256(
+                    reinterpret_cast<__m256i*>(rgbs + index * 3 + pair * 32),
+                    _mm256_or_si256(
+                        _mm256_shuffle_epi8(
+                            load_pair_avx2(rgs + low_first * 2, rgs + high_first * 2), rg_pair_masks[pair]),
+                        _mm256_shuffle_epi8(load_pair_avx2(bs + low_first, bs + high_first), b_pair_masks[pair])));
+            }
+        }
+        for (; index + 32 <= count; index += 16) {
+            for (std::size_t chunk = 0; chunk < 3; ++chunk) {
+                const auto first = chunk * 16 / 3;
+                _mm_storeu_si128(
+                    reinterpret_cast<__m128i*>(rgbs + index * 3 + chunk * 16),
+                    interleave_chunk_ssse3(rgs + (index + first) * 2, bs + index + first, chunk));
             }
+        }
+        interleave_row_scalar(rgs + index * 2, bs + index, rgbs + index * 3, count - index);
+    }
+#elif defined(HUMMINGBIRD_NEON)
+    /// interleave_row_neon is the NEON version of interleave_row_scalar (16 pixels per iteration).
+    inline void interleave_row_neon(const uint8_t* rgs, const uint8_t* bs, uint8_t* rgbs, std::size_t count) {
+        std::size_t index = 0;
+        for (; index + 16 <= count; index += 16) {
+            const auto red_and_green = vld2q_u8(rgs + index * 2);
+            uint8x16x3_t red_green_and_blue;
+            red_green_and_blue.val[0] = red_and_green.val[0];
+            red_green_and_blue.val[1] = red_and_green.val[1];
+            red_green_and_blue.val[2] = vld1q_u8(bs + index);
+            vst3q_u8(rgbs + index * 3, red_green_and_blue);
+        }
+        interleave_row_scalar(rgs + index * 2, bs + index, rgbs + index * 3, count - index);
+    }
+#endif
+
+    /// interleave_row merges count red-green pairs and count blue bytes into packed RGB triplets.
+    /// There is no SSE2 kernel (byte shuffles require SSSE3), hence the sse2 set uses the scalar kernel.
+    inline void
+    interleave_row(instruction_set set, const uint8_t* rgs, const uint8_t* bs, uint8_t* rgbs, std::size_t count) {
+        switch (set) {
+#if defined(HUMMINGBIRD_X86)
+            case instruction_set::ssse3:
+                interleave_row_ssse3(rgs, bs, rgbs, count);
+                return;
+            case instruction_set::avx2:
+                interleave_row_avx2(rgs, bs, rgbs, count);
+                return;
+#elif defined(HUMMINGBIRD_NEON)
+            case instruction_set::neon:
+                interleave_row_neon(rgs, bs, rgbs, count);
+                return;
+#endif
+            default:
+                break;
+        }
+        interleave_row_scalar(rgs, bs, rgbs, count);
+    }
+
+    /// interleave converts a decoded YUV420 frame to RGB bytes.
+    /// The red and green bytes are the Y plane pairs, and the blue bytes alternate between U (even rows) and V (odd
+    /// rows). frame and rgbs must hold Device::frame_size bytes.
+    template <typename Device = lightcrafter_1440_hz>
+    inline void interleave(instruction_set set, const uint8_t* frame, uint8_t* rgbs) {
+        const uint8_t* rgs = frame;
+        const uint8_t* active_b = frame + Device::pixels * 2;
+        const uint8_t* idle_b = active_b + Device::pixels / 2;
+        for (std::size_t y = 0; y < Device::height; ++y) {
+            interleave_row(set, rgs, active_b, rgbs, Device::width);
+            rgs += Device::width * 2;
+            active_b += Device::width;
+            rgbs += Device::width * 3;
             std::swap(active_b, idle_b);
         }
-        gst_memory_unmap(memory->gobj(), info.gobj());
+    }
+
+    /// interleave converts a decoded YUV420 frame to RGB bytes with the most efficient instruction set.
+    template <typename Device = lightcrafter_1440_hz>
+    inline void interleave(const uint8_t* frame, uint8_t* rgbs) {
+        static const auto set = detect_instruction_set();
+        interleave<Device>(set, frame, rgbs);
     }
 }
@@ -0,0 +1,396 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/// hummingbird bundles tools to create and play high framerate videos.
+namespace hummingbird {
+    /// frame_reader provides fixed-size chunks of a raw stream.
+    class frame_reader {
+        public:
+        frame_reader() = default;
+        frame_reader(const frame_reader&) = delete;
+        frame_reader(frame_reader&&) = default;
+        frame_reader& operator=(const frame_reader&) = delete;
+        frame_reader& operator=(frame_reader&&) = default;
+        virtual ~frame_reader() {}
+
+        /// read returns a pointer to the next size bytes, or nullptr if the stream ends before.
+        /// The bytes are either copied to buffer or read in place, in which case buffer may be nullptr.
+        /// The returned pointer remains valid until the reader is destroyed or buffer is reused.
+        virtual const uint8_t* read(uint8_t* buffer, std::size_t size) = 0;
+
+        /// in_place returns true if read never uses its buffer.
+        virtual bool in_place() const {
+            return false;
+        }
+    };
+
+    /// stream_frame_reader reads from a standard input stream.
+    class stream_frame_reader : public frame_reader {
+        public:
+        stream_frame_reader(std::istream& input) : _input(input) {}
+        stream_frame_reader(const stream_frame_reader&) = delete;
+        stream_frame_reader(stream_frame_reader&&) = default;
+        stream_frame_reader& operator=(const stream_frame_reader&) = delete;
+        stream_frame_reader& operator=(stream_frame_reader&&) = default;
+        virtual ~stream_frame_reader() {}
+
+        virtual const uint8_t* read(uint8_t* buffer, std::size_t size) override {
+            _input.read(reinterpret_cast<char*>(buffer), size);
+            if (static_cast<std::size_t>(_input.gcount()) != size) {
+                return nullptr;
+            }
+            return buffer;
+        }
+
+        protected:
+        std::istream& _input;
+    };
+
+    /// file_descriptor_frame_reader reads from a file descriptor with read(2), bypassing stream buffers.
+    class file_descriptor_frame_reader : public frame_reader {
+        public:
+        file_descriptor_frame_reader(int file_descriptor) : _file_descriptor(file_descriptor) {}
+        file_descriptor_frame_reader(const file_descriptor_frame_reader&) = delete;
+        file_descriptor_frame_reader(file_descriptor_frame_reader&&) = default;
+        file_descriptor_frame_reader& operator=(const file_descriptor_frame_reader&) = delete;
+        file_descriptor_frame_reader& operator=(file_descriptor_frame_reader&&) = default;
+        virtual ~file_descriptor_frame_reader() {}
+
+        virtual const uint8_t* read(uint8_t* buffer, std::size_t size) override {
+            std::size_t offset = 0;
+            while (offset < size) {
+                const auto bytes_read = ::read(_file_descriptor, buffer + offset, size - offset);
+                if (bytes_read < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::runtime_error(std::string("reading the input failed: ") + std::strerror(errno));
+                }
+                if (bytes_read == 0) {
+                    return nullptr;
+                }
+                offset += static_cast<std::size_t>(bytes_read);
+            }
+            return buffer;
+        }
+
+        protected:
+        int _file_descriptor;
+    };
+
+    /// mapped_frame_reader walks a memory-mapped file in place.
+    class mapped_frame_reader : public frame_reader {
+        public:
+        mapped_frame_reader(const std::string& filename) : _data(nullptr), _size(0), _offset(0) {
+            const auto file_descriptor = open(filename.c_str(), O_RDONLY);
+            if (file_descriptor < 0) {
+                throw std::runtime_error(std::string("'") + filename + "' could not be open for reading");
+            }
+            struct stat status;
+            if (fstat(file_descriptor, &status) < 0) {
+                ::close(file_descriptor);
+                throw std::runtime_error(std::string("retrieving the size of '") + filename + "' failed");
+            }
+            _size = static_cast<std::size_t>(status.st_size);
+            if (_size > 0) {
+                auto data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+                if (data == MAP_FAILED) {
+                    ::close(file_descriptor);
+                    throw std::runtime_error(std::string("mapping '") + filename + "' failed");
+                }
+                _data = reinterpret_cast<const uint8_t*>(data);
+                madvise(data, _size, MADV_SEQUENTIAL);
+            }
+            ::close(file_descriptor);
+        }
+        mapped_frame_reader(const mapped_frame_reader&) = delete;
+        mapped_frame_reader(mapped_frame_reader&&) = default;
+        mapped_frame_reader& operator=(const mapped_frame_reader&) = delete;
+        mapped_frame_reader& operator=(mapped_frame_reader&&) = default;
+        virtual ~mapped_frame_reader() {
+            if (_data) {
+                munmap(const_cast<uint8_t*>(_data), _size);
+            }
+        }
+
+        virtual const uint8_t* read(uint8_t*, std::size_t size) override {
+            if (_size - _offset < size) {
+                return nullptr;
+            }
+            const auto bytes = _data + _offset;
+            _offset += size;
+            return bytes;
+        }
+
+        virtual bool in_place() const override {
+            return true;
+        }
+
+        /// data returns the first byte of the file.
+        const uint8_t* data() const {
+            return _data;
+        }
+
+        /// size returns the number of bytes in the file.
+        std::size_t size() const {
+            return _size;
+        }
+
+        protected:
+        const uint8_t* _data;
+        std::size_t _size;
+        std::size_t _offset;
+    };
+
+    /// memory_frame_reader walks a byte range in place.
+    /// The bytes must remain valid until the reader is destroyed.
+    class memory_frame_reader : public frame_reader {
+        public:
+        memory_frame_reader(const uint8_t* data, std::size_t size) : _data(data), _size(size), _offset(0) {}
+        memory_frame_reader(const memory_frame_reader&) = delete;
+        memory_frame_reader(memory_frame_reader&&) = default;
+        memory_frame_reader& operator=(const memory_frame_reader&) = delete;
+        memory_frame_reader& operator=(memory_frame_reader&&) = default;
+        virtual ~memory_frame_reader() {}
+
+        virtual const uint8_t* read(uint8_t*, std::size_t size) override {
+            if (_size - _offset < size) {
+                return nullptr;
+            }
+            const auto bytes = _data + _offset;
+            _offset += size;
+            return bytes;
+        }
+
+        virtual bool in_place() const override {
+            return true;
+        }
+
+        protected:
+        const uint8_t* _data;
+        std::size_t _size;
+        std::size_t _offset;
+    };
+
+    /// yuv4mpeg2_frame_reader reads the frames of a YUV4MPEG2 stream provided by another reader.
+    /// The stream header is parsed by the constructor, and the frame headers are skipped by read.
+    class yuv4mpeg2_frame_reader : public frame_reader {
+        public:
+        yuv4mpeg2_frame_reader(frame_reader& reader) : _reader(reader), _width(0), _height(0), _chroma("420jpeg") {
+            std::string header;
+            if (!read_line(header) || header.compare(0, 10, "YUV4MPEG2 ") != 0) {
+                throw std::runtime_error("the input is not a YUV4MPEG2 stream");
+            }
+            std::size_t begin = 10;
+            while (begin < header.size()) {
+                auto end = header.find(' ', begin);
+                if (end == std::string::npos) {
+                    end = header.size();
+                }
+                if (end > begin + 1) {
+                    const auto value = header.substr(begin + 1, end - begin - 1);
+                    switch (header[begin]) {
+                        case 'W':
+                            _width = std::stoull(value);
+                            break;
+                        case 'H':
+                            _height = std::stoull(value);
+                            break;
+                        case 'C':
+                            _chroma = value;
+                            break;
+                        default:
+                            break;
+                    }
+                }
+                begin = end + 1;
+            }
+        }
+        yuv4mpeg2_frame_reader(const yuv4mpeg2_frame_reader&) = delete;
+        yuv4mpeg2_frame_reader(yuv4mpeg2_frame_reader&&) = default;
+        yuv4mpeg2_frame_reader& operator=(const yuv4mpeg2_frame_reader&) = delete;
+        yuv4mpeg2_frame_reader& operator=(yuv4mpeg2_frame_reader&&) = default;
+        virtual ~yuv4mpeg2_frame_reader() {}
+
+        virtual const uint8_t* read(uint8_t* buffer, std::size_t size) override {
+            std::string header;
+            if (!read_line(header)) {
+                return nullptr;
+            }
+            if (header.compare(0, 5, "FRAME") != 0) {
+                throw std::runtime_error("unexpected YUV4MPEG2 frame header");
+            }
+            return _reader.read(buffer, size);
+        }
+
+        virtual bool in_place() const override {
+            return _reader.in_place();
+        }
+
+        /// width returns the number of columns of a frame.
+        std::size_t width() const {
+            return _width;
+        }
+
+        /// height returns the number of rows of a frame.
+        std::size_t height() const {
+            return _height;
+        }
+
+        /// chroma returns the colour space of the stream (420jpeg if the header does not specify it).
+        const std::string& chroma() const {
+            return _chroma;
+        }
+
+        protected:
+        /// read_line reads bytes up to the next newline, and returns false if the stream ends before.
+        bool read_line(std::string& line) {
+            line.clear();
+            for (;;) {
+                const auto byte = _reader.read(&_byte, 1);
+                if (!byte) {
+                    return false;
+                }
+                if (*byte == '\n') {
+                    return true;
+                }
+                line.push_back(static_cast<char>(*byte));
+            }
+        }
+
+        frame_reader& _reader;
+        std::size_t _width;
+        std::size_t _height;
+        std::string _chroma;
+        uint8_t _byte;
+    };
+
+    /// frame_writer sends YUV4MPEG2 frames to an output.
+    class frame_writer {
+        public:
+        frame_writer() = default;
+        frame_writer(const frame_writer&) = delete;
+        frame_writer(frame_writer&&) = default;
+        frame_writer& operator=(const frame_writer&) = delete;
+        frame_writer& operator=(frame_writer&&) = default;
+        virtual ~frame_writer() {}
+
+        /// write sends a header followed by size bytes.
+        virtual void write(const std::string& header, const uint8_t* bytes, std::size_t size) = 0;
+
+        /// retained returns the number of previously written buffers that may still be referenced by the output.
+        /// These buffers must not be modified until retained other buffers have been written.
+        virtual std::size_t retained() const {
+            return 0;
+        }
+    };
+
+    /// stream_frame_writer writes to a standard output stream.
+    class stream_frame_writer : public frame_writer {
+        public:
+        stream_frame_writer(std::ostream& output) : _output(output) {}
+        stream_frame_writer(const stream_frame_writer&) = delete;
+        stream_frame_writer(stream_frame_writer&&) = default;
+        stream_frame_writer& operator=(const stream_frame_writer&) = delete;
+        stream_frame_writer& operator=(stream_frame_writer&&) = default;
+        virtual ~stream_frame_writer() {}
+
+        virtual void write(const std::string& header, const uint8_t* bytes, std::size_t size) override {
+            _output << header;
+            _output.write(reinterpret_cast<const char*>(bytes), size);
+        }
+
+        protected:
+        std::ostream& _output;
+    };
+
+    /// file_descriptor_frame_writer writes to a file descriptor with writev(2).
+    /// On Linux, if the file descriptor is a pipe smaller than the frames, bytes are spliced into the pipe with
+    /// vmsplice(2) instead of being copied. The last written buffer is then retained by the pipe.
+    class file_descriptor_frame_writer : public frame_writer {
+        public:
+        file_descriptor_frame_writer(int file_descriptor, std::size_t frame_size) :
+            _file_descriptor(file_descriptor),
+            _splice(false) {
+#if defined(__linux__)
+            struct stat status;
+            if (fstat(_file_descriptor, &status) == 0 && S_ISFIFO(status.st_mode)) {
+                const auto pipe_size = fcntl(_file_descriptor, F_GETPIPE_SZ);
+                _splice = pipe_size > 0 && static_cast<std::size_t>(pipe_size) < frame_size;
+            }
+#endif
+        }
+        file_descriptor_frame_writer(const file_descriptor_frame_writer&) = delete;
+        file_descriptor_frame_writer(file_descriptor_frame_writer&&) = default;
+        file_descriptor_frame_writer& operator=(const file_descriptor_frame_writer&) = delete;
+        file_descriptor_frame_writer& operator=(file_descriptor_frame_writer&&) = default;
+        virtual ~file_descriptor_frame_writer() {}
+
+        virtual void write(const std::string& header, const uint8_t* bytes, std::size_t size) override {
+            iovec vectors[2];
+            vectors[0].iov_base = const_cast<char*>(header.data());
+            vectors[0].iov_len = header.size();
+            vectors[1].iov_base = const_cast<uint8_t*>(bytes);
+            vectors[1].iov_len = size;
+            if (_splice) {
+                write_vectors(vectors, 1, false);
+                write_vectors(vectors + 1, 1, true);
+            } else {
+                write_vectors(vectors, 2, false);
+            }
+        }
+
+        virtual std::size_t retained() const override {
+            return _splice ? 1 : 0;
+        }
+
+        protected:
+        /// write_vectors writes or splices all the given vectors, resuming after partial writes.
+        void write_vectors(iovec* vectors, std::size_t count, bool splice) {
+            while (count > 0) {
+                ssize_t bytes_written;
+#if defined(__linux__)
+                if (splice) {
+                    bytes_written = vmsplice(_file_descriptor, vectors, count, 0);
+                } else {
+                    bytes_written = writev(_file_descriptor, vectors, static_cast<int>(count));
+                }
+#else
+                bytes_written = writev(_file_descriptor, vectors, static_cast<int>(count));
+#endif
+                if (bytes_written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::runtime_error(std::string("writing the output failed: ") + std::strerror(errno));
+                }
+                auto advance = static_cast<std::size_t>(bytes_written);
+                while (count > 0 && advance >= vectors->iov_len) {
+                    advance -= vectors->iov_len;
+                    ++vectors;
+                    --count;
+                }
+                if (advance > 0) {
+                    vectors->iov_base = static_cast<uint8_t*>(vectors->iov_base) + advance;
+                    vectors->iov_len -= advance;
+                }
+            }
+        }
+
+        int _file_descriptor;
+        bool _splice;
+    };
+}
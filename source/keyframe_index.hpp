@@ -0,0 +1,280 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+/// hummingbird bundles tools to create and play high framerate videos.
+namespace hummingbird {
+    /// keyframe_index_signature starts every keyframe index sidecar.
+    const char keyframe_index_signature[8] = {'H', 'B', 'K', 'E', 'Y', 'F', 'R', 'M'};
+
+    /// keyframe_index_version is the version of the sidecar layout.
+    const uint32_t keyframe_index_version = 1;
+
+    /// keyframe_index lists the key frames of the video track of a MP4 file.
+    /// The key frames are read from the sample table of the track (the 'stss' box, or every sample if the box is
+    /// missing) without decoding the file, and saved to a sidecar file (the video path followed by '.keyframes') so
+    /// that later seeks load them instead. Sidecars are rebuilt when the modification time or the size of the video
+    /// changes, and failing to save a sidecar (for instance in a read-only directory) is not an error.
+    /// Key frames are assumed to start closed groups of pictures (the libx264 default), hence the decode index of a
+    /// key frame is also its display index.
+    class keyframe_index {
+        public:
+        keyframe_index(const std::string& filename) : _frames(0) {
+            struct stat status;
+            if (stat(filename.c_str(), &status) != 0) {
+                throw std::runtime_error(std::string("'") + filename + "' could not be open for reading");
+            }
+            const auto modification = static_cast<int64_t>(status.st_mtime);
+            const auto size = static_cast<int64_t>(status.st_size);
+            const auto sidecar = filename + ".keyframes";
+            if (!load(sidecar, modification, size)) {
+                build(filename);
+                save(sidecar, modification, size);
+            }
+        }
+        keyframe_index(const keyframe_index&) = delete;
+        keyframe_index(keyframe_index&&) = default;
+        keyframe_index& operator=(const keyframe_index&) = delete;
+        keyframe_index& operator=(keyframe_index&&) = default;
+        virtual ~keyframe_index() {}
+
+        /// frames returns the number of frames in the video track.
+        std::size_t frames() const {
+            return _frames;
+        }
+
+        /// keyframes returns the indices of the key frames, in increasing order.
+        const std::vector<uint64_t>& keyframes() const {
+            return _keyframes;
+        }
+
+        /// keyframe_before returns the index of the last key frame at or before the given frame.
+        std::size_t keyframe_before(std::size_t frame) const {
+            const auto keyframe = std::upper_bound(_keyframes.begin(), _keyframes.end(), frame);
+            if (keyframe == _keyframes.begin()) {
+                return 0;
+            }
+            return static_cast<std::size_t>(*std::prev(keyframe));
+        }
+
+        protected:
+        /// box is the payload of a MP4 box, without its header.
+        struct box {
+            const uint8_t* begin;
+            const uint8_t* end;
+        };
+
+        /// read_big_endian reads an unsigned integer stored on size bytes, most significant byte first.
+        static uint64_t read_big_endian(const uint8_t* bytes, std::size_t size) {
+            uint64_t value = 0;
+            for (std::size_t index = 0; index < size; ++index) {
+                value = (value << 8) | bytes[index];
+            }
+            return value;
+        }
+
+        /// children returns the boxes of the given type directly inside a payload.
+        static std::vector<box> children(const box& parent, const char* type) {
+            std::vector<box> result;
+            auto position = parent.begin;
+            while (parent.end - position >= 8) {
+                auto size = read_big_endian(position, 4);
+                std::size_t header_size = 8;
+                if (size == 1) {
+                    if (parent.end - position < 16) {
+                        break;
+                    }
+                    size = read_big_endian(position + 8, 8);
+                    header_size = 16;
+                } else if (size == 0) {
+                    size = static_cast<uint64_t>(parent.end - position);
+                }
+                if (size < header_size || size > static_cast<uint64_t>(parent.end - position)) {
+                    throw std::runtime_error("the MP4 box structure is corrupted");
+                }
+                if (std::equal(type, type + 4, position + 4)) {
+                    result.push_back(box{position + header_size, position + size});
+                }
+                position += size;
+            }
+            return result;
+        }
+
+        /// child returns the first box of the given type inside a payload, and throws if there is none.
+        static box child(const box& parent, const char* type) {
+            const auto boxes = children(parent, type);
+            if (boxes.empty()) {
+                throw std::runtime_error(std::string("the MP4 box '") + type + "' is missing");
+            }
+            return boxes.front();
+        }
+
+        /// read_moov loads the payload of the file's top-level 'moov' box, skipping the media data.
+        static std::vector<uint8_t> read_moov(const std::string& filename) {
+            std::ifstream input(filename, std::ios::binary);
+            if (!input.good()) {
+                throw std::runtime_error(std::string("'") + filename + "' could not be open for reading");
+            }
+            input.seekg(0, std::ios::end);
+            const auto file_size = static_cast<uint64_t>(input.tellg());
+            uint64_t offset = 0;
+            while (file_size - offset >= 8) {
+                uint8_t header[16];
+                input.seekg(static_cast<std::streamoff>(offset));
+                input.read(reinterpret_cast<char*>(header), 8);
+                auto size = read_big_endian(header, 4);
+                uint64_t header_size = 8;
+                if (size == 1) {
+                    input.read(reinterpret_cast<char*>(header + 8), 8);
+                    size = read_big_endian(header + 8, 8);
+                    header_size = 16;
+                } else if (size == 0) {
+                    size = file_size - offset;
+                }
+                if (!input.good() || size < header_size || size > file_size - offset) {
+                    break;
+                }
+                if (std::equal(header + 4, header + 8, "moov")) {
+                    std::vector<uint8_t> payload(static_cast<std::size_t>(size - header_size));
+                    input.read(reinterpret_cast<char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+                    if (!input.good()) {
+                        break;
+                    }
+                    return payload;
+                }
+                offset += size;
+            }
+            throw std::runtime_error(std::string("'") + filename + "' is not a MP4 file with an index ('moov' box)");
+        }
+
+        /// build reads the key frames from the sample table of the first video track.
+        void build(const std::string& filename) {
+            const auto payload = read_moov(filename);
+            const box moov{payload.data(), payload.data() + payload.size()};
+            try {
+                if (!children(moov, "mvex").empty()) {
+                    throw std::runtime_error("fragmented MP4 files are not supported");
+                }
+                for (const auto& trak : children(moov, "trak")) {
+                    const auto mdia = child(trak, "mdia");
+                    const auto hdlr = child(mdia, "hdlr");
+                    if (hdlr.end - hdlr.begin < 12 || !std::equal(hdlr.begin + 8, hdlr.begin + 12, "vide")) {
+                        continue;
+                    }
+                    const auto stbl = child(child(mdia, "minf"), "stbl");
+                    auto sample_sizes = children(stbl, "stsz");
+                    if (sample_sizes.empty()) {
+                        sample_sizes = children(stbl, "stz2");
+                    }
+                    if (sample_sizes.empty() || sample_sizes.front().end - sample_sizes.front().begin < 12) {
+                        throw std::runtime_error("the MP4 sample sizes are missing");
+                    }
+                    _frames = static_cast<std::size_t>(read_big_endian(sample_sizes.front().begin + 8, 4));
+                    _keyframes.clear();
+                    const auto sync_samples = children(stbl, "stss");
+                    if (sync_samples.empty()) {
+                        _keyframes.reserve(_frames);
+                        for (std::size_t frame = 0; frame < _frames; ++frame) {
+                            _keyframes.push_back(frame);
+                        }
+                        return;
+                    }
+                    const auto& stss = sync_samples.front();
+                    if (stss.end - stss.begin < 8) {
+                        throw std::runtime_error("the MP4 sync samples are truncated");
+                    }
+                    const auto count = static_cast<std::size_t>(read_big_endian(stss.begin + 4, 4));
+                    if (static_cast<std::size_t>(stss.end - stss.begin - 8) / 4 < count) {
+                        throw std::runtime_error("the MP4 sync samples are truncated");
+                    }
+                    _keyframes.reserve(count);
+                    for (std::size_t index = 0; index < count; ++index) {
+                        const auto sample = read_big_endian(stss.begin + 8 + index * 4, 4);
+                        if (sample == 0 || sample > _frames) {
+                            throw std::runtime_error("the MP4 sync samples are corrupted");
+                        }
+                        _keyframes.push_back(sample - 1);
+                    }
+                    std::sort(_keyframes.begin(), _keyframes.end());
+                    return;
+                }
+                throw std::runtime_error("there is no video track");
+            } catch (const std::runtime_error& error) {
+                throw std::runtime_error(std::string("indexing '") + filename + "' failed: " + error.what());
+            }
+        }
+
+        /// load reads a sidecar, and returns false if it is missing, invalid or out of date.
+        bool load(const std::string& sidecar, int64_t modification, int64_t size) {
+            std::ifstream input(sidecar, std::ios::binary);
+            if (!input.good()) {
+                return false;
+            }
+            const auto read = [&](std::size_t size) {
+                uint8_t bytes[8] = {};
+                input.read(reinterpret_cast<char*>(bytes), static_cast<std::streamsize>(size));
+                uint64_t value = 0;
+                for (std::size_t index = 0; index < size; ++index) {
+                    value |= static_cast<uint64_t>(bytes[index]) << (index * 8);
+                }
+                return value;
+            };
+            char signature[sizeof(keyframe_index_signature)];
+            input.read(signature, sizeof(signature));
+            if (!input.good()
+                || !std::equal(std::begin(signature), std::end(signature), std::begin(keyframe_index_signature))
+                || read(4) != keyframe_index_version || static_cast<int64_t>(read(8)) != modification
+                || static_cast<int64_t>(read(8)) != size) {
+                return false;
+            }
+            const auto frames = read(8);
+            const auto count = read(8);
+            if (!input.good() || count > frames || frames > std::numeric_limits<std::size_t>::max()) {
+                return false;
+            }
+            std::vector<uint64_t> keyframes(static_cast<std::size_t>(count));
+            for (auto& keyframe : keyframes) {
+                keyframe = read(8);
+            }
+            if (!input.good() || !std::is_sorted(keyframes.begin(), keyframes.end())
+                || (!keyframes.empty() && keyframes.back() >= frames)) {
+                return false;
+            }
+            _frames = static_cast<std::size_t>(frames);
+            _keyframes.swap(keyframes);
+            return true;
+        }
+
+        /// save writes a sidecar (in little endian: signature, version on 32 bits, the video's modification time,
+        /// size, number of frames and number of key frames on 64 bits, and the key frames on 64 bits each).
+        void save(const std::string& sidecar, int64_t modification, int64_t size) const {
+            std::vector<uint8_t> bytes(std::begin(keyframe_index_signature), std::end(keyframe_index_signature));
+            const auto write = [&](uint64_t value, std::size_t size) {
+                for (std::size_t index = 0; index < size; ++index) {
+                    bytes.push_back(static_cast<uint8_t>(value >> (index * 8)));
+                }
+            };
+            write(keyframe_index_version, 4);
+            write(static_cast<uint64_t>(modification), 8);
+            write(static_cast<uint64_t>(size), 8);
+            write(_frames, 8);
+            write(_keyframes.size(), 8);
+            for (const auto keyframe : _keyframes) {
+                write(keyframe, 8);
+            }
+            std::ofstream output(sidecar, std::ios::binary | std::ios::trunc);
+            output.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        }
+
+        std::size_t _frames;
+        std::vector<uint64_t> _keyframes;
+    };
+}
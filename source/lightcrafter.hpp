@@ -1,5 +1,6 @@
 #pragma once
 
+#include "device.hpp"
 #include <algorithm>
 #include <arpa/inet.h>
 #include <fcntl.h>
@@ -86,19 +87,46 @@ namespace hummingbird {
             return base_settings;
         }
 
-        /// high_framerate_settings returns the high framerate settings used by the
-        /// library.
+        /// high_framerate_settings returns the pattern settings matching a device
+        /// description. The video input resolution and the bit depth are derived
+        /// from the device.
+        template <typename Device>
         static std::vector<setting> high_framerate_settings() {
             return {
                 {"display mode", {2, 1, 1, 0, 1, 0, 2}, {3, 1, 1, 0, 0, 0}},
                 {"led current", {2, 1, 4, 0, 6, 0, 18, 1, 18, 1, 18, 1}, {3, 1, 4, 0, 0, 0}},
                 {"display", {2, 1, 7, 0, 3, 0, 0, 1, 0}, {3, 1, 7, 0, 0, 0}},
-                {"video input", {2, 2, 0, 0, 12, 0, 96, 2, 172, 2, 0, 0, 0, 0, 96, 2, 172, 2}, {3, 2, 0, 0, 0, 0}},
-                {"video mode", {2, 2, 1, 0, 3, 0, 60, 1, 3}, {3, 2, 1, 0, 0, 0}},
+                {"video input",
+                 {2,
+                  2,
+                  0,
+                  0,
+                  12,
+                  0,
+                  Device::width & 0xff,
+                  Device::width >> 8,
+                  Device::height & 0xff,
+                  Device::height >> 8,
+                  0,
+                  0,
+                  0,
+                  0,
+                  Device::width & 0xff,
+                  Device::width >> 8,
+                  Device::height & 0xff,
+                  Device::height >> 8},
+                 {3, 2, 0, 0, 0, 0}},
+                {"video mode", {2, 2, 1, 0, 3, 0, 60, Device::bits_per_pattern, 3}, {3, 2, 1, 0, 0, 0}},
                 {"trigger output", {2, 4, 4, 0, 11, 0, 1, 0, 0, 0, 0, 0, 0, 100, 0, 0, 0}, {3, 4, 4, 0, 0, 0}},
             };
         }
 
+        /// high_framerate_settings returns the high framerate settings used by the
+        /// library.
+        static std::vector<setting> high_framerate_settings() {
+            return high_framerate_settings<lightcrafter_1440_hz>();
+        }
+
         /// default_settings returns the default settings to use the LightCrafter as a
         /// regular projector.
         static std::vector<setting> default_settings() {
@@ -0,0 +1,327 @@
+#pragma once
+
+#include "frame_store.hpp"
+#include "io.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/// hummingbird bundles tools to create and play high framerate videos.
+namespace hummingbird {
+    /// live_ring_signature starts the control page of every live ring.
+    const char live_ring_signature[8] = {'H', 'B', 'L', 'I', 'V', 'E', 'R', 'G'};
+
+    /// live_ring_version is the version of the control page layout.
+    const uint32_t live_ring_version = 1;
+
+    /// live_ring_maximum_slots is the largest number of frames in a live ring.
+    const std::size_t live_ring_maximum_slots = 256;
+
+    /// live_ring_control is the first page of a live ring, shared by the producer and the consumer processes.
+    /// It uses the native layout, since both processes run on the same machine. The counters are never wrapped:
+    /// frame n is stored in slot n % slots, and the producer and the consumer write to separate cache lines.
+    struct live_ring_control {
+        char signature[8];
+        uint32_t version;
+        frame_store_format format;
+        uint32_t width;
+        uint32_t height;
+        uint64_t frame_size;
+        uint64_t stride;
+        uint64_t slots;
+
+        /// written is the number of published frames, incremented by the producer.
+        alignas(64) std::atomic<uint64_t> written;
+
+        /// released is the number of frames released by the consumer, whose slots may be overwritten.
+        alignas(64) std::atomic<uint64_t> released;
+
+        /// closed is set by the producer after the last frame.
+        alignas(64) std::atomic<uint32_t> closed;
+
+        /// published holds the steady clock time at which the frame in each slot was published, in nanoseconds.
+        alignas(64) int64_t published[live_ring_maximum_slots];
+    };
+    static_assert(sizeof(live_ring_control) <= frame_store_alignment, "the live ring control exceeds one page");
+
+    /// live_ring_now returns the steady clock time in nanoseconds, comparable between processes.
+    inline int64_t live_ring_now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    /// live_ring_writer creates a single-producer single-consumer ring of frames in POSIX shared memory.
+    /// Frames can be packed in place (acquire, then publish), or copied from generate's pipeline (write).
+    /// The shared memory object is removed when the writer is destroyed, consumers keep their mapping.
+    /// Creating a ring whose name is in use fails, unless replace is true: the existing object (for instance left
+    /// by a crashed producer) is then removed first, and processes using it keep a ring which is no longer fed.
+    class live_ring_writer : public frame_writer {
+        public:
+        live_ring_writer(
+            const std::string& name,
+            frame_store_format format,
+            uint32_t width,
+            uint32_t height,
+            std::size_t frame_size,
+            std::size_t slots = 4,
+            bool replace = false) :
+            _name(name), _data(nullptr), _size(0), _control(nullptr), _written(0) {
+            static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the live ring requires lock-free 64-bit atomics");
+            if (slots == 0 || slots > live_ring_maximum_slots) {
+                throw std::logic_error(
+                    std::string("the number of slots must be in the range [1, ")
+                    + std::to_string(live_ring_maximum_slots) + "]");
+            }
+            const auto stride =
+                (frame_size + frame_store_alignment - 1) / frame_store_alignment * frame_store_alignment;
+            _size = frame_store_alignment + slots * stride;
+            if (replace) {
+                shm_unlink(name.c_str());
+            }
+            const auto file_descriptor = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+            if (file_descriptor < 0) {
+                if (errno == EEXIST) {
+                    throw std::runtime_error(std::string("the live ring '") + name + "' already exists");
+                }
+                throw std::runtime_error(
+                    std::string("creating the shared memory '") + name + "' failed: " + std::strerror(errno));
+            }
+            if (ftruncate(file_descriptor, static_cast<off_t>(_size)) < 0) {
+                ::close(file_descriptor);
+                shm_unlink(name.c_str());
+                throw std::runtime_error(std::string("resizing the shared memory '") + name + "' failed");
+            }
+            auto data = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor, 0);
+            ::close(file_descriptor);
+            if (data == MAP_FAILED) {
+                shm_unlink(name.c_str());
+                throw std::runtime_error(std::string("mapping the shared memory '") + name + "' failed");
+            }
+            _data = reinterpret_cast<uint8_t*>(data);
+            _control = new (_data) live_ring_control;
+            _control->version = live_ring_version;
+            _control->format = format;
+            _control->width = width;
+            _control->height = height;
+            _control->frame_size = frame_size;
+            _control->stride = stride;
+            _control->slots = slots;
+            _control->written.store(0, std::memory_order_relaxed);
+            _control->released.store(0, std::memory_order_relaxed);
+            _control->closed.store(0, std::memory_order_relaxed);
+            std::fill(std::begin(_control->published), std::end(_control->published), 0);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::copy(std::begin(live_ring_signature), std::end(live_ring_signature), _control->signature);
+        }
+        live_ring_writer(const live_ring_writer&) = delete;
+        live_ring_writer(live_ring_writer&&) = default;
+        live_ring_writer& operator=(const live_ring_writer&) = delete;
+        live_ring_writer& operator=(live_ring_writer&&) = default;
+        virtual ~live_ring_writer() {
+            if (_data) {
+                _control->closed.store(1, std::memory_order_release);
+                munmap(_data, _size);
+                shm_unlink(_name.c_str());
+            }
+        }
+
+        /// acquire returns the slot of the next frame, or nullptr if the consumer has not released a slot yet.
+        /// The frame is sent by publish.
+        virtual uint8_t* acquire() {
+            if (_written - _control->released.load(std::memory_order_acquire) >= _control->slots) {
+                return nullptr;
+            }
+            return _data + frame_store_alignment + (_written % _control->slots) * _control->stride;
+        }
+
+        /// publish timestamps and sends the frame written to the slot returned by acquire.
+        virtual void publish() {
+            _control->published[_written % _control->slots] = live_ring_now();
+            ++_written;
+            _control->written.store(_written, std::memory_order_release);
+        }
+
+        /// write waits for a free slot, and copies and publishes a frame. Zero-size writes (such as the YUV4MPEG2
+        /// stream header) are ignored.
+        virtual void write(const std::string&, const uint8_t* bytes, std::size_t size) override {
+            if (size == 0) {
+                return;
+            }
+            if (size != _control->frame_size) {
+                throw std::logic_error("unexpected frame size");
+            }
+            uint8_t* slot;
+            while (!(slot = acquire())) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+            std::copy(bytes, bytes + size, slot);
+            publish();
+        }
+
+        /// close tells the consumer that no more frames will be published.
+        virtual void close() {
+            _control->closed.store(1, std::memory_order_release);
+        }
+
+        /// slots returns the number of frames in the ring.
+        std::size_t slots() const {
+            return static_cast<std::size_t>(_control->slots);
+        }
+
+        protected:
+        std::string _name;
+        uint8_t* _data;
+        std::size_t _size;
+        live_ring_control* _control;
+        uint64_t _written;
+    };
+
+    /// live_ring_reader consumes the frames of a live ring created by another process.
+    /// read hands out the frames in place, wrapped in shared pointers which release their slot when their last copy
+    /// is destroyed (from any thread). Slots are returned to the producer in order, hence a frame held for long stalls
+    /// the producer. The frames remain valid after the reader is destroyed, until released.
+    class live_ring_reader {
+        public:
+        live_ring_reader(const std::string& name) : _state(new state), _read(0) {
+            const auto file_descriptor = shm_open(name.c_str(), O_RDWR, 0);
+            if (file_descriptor < 0) {
+                throw std::runtime_error(
+                    std::string("opening the shared memory '") + name + "' failed: " + std::strerror(errno));
+            }
+            struct stat status;
+            if (fstat(file_descriptor, &status) < 0) {
+                ::close(file_descriptor);
+                throw std::runtime_error(std::string("retrieving the size of the shared memory '") + name + "' failed");
+            }
+            _state->size = static_cast<std::size_t>(status.st_size);
+            if (_state->size < frame_store_alignment) {
+                ::close(file_descriptor);
+                throw std::runtime_error(std::string("the shared memory '") + name + "' is not a live ring");
+            }
+            auto data = mmap(nullptr, _state->size, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor, 0);
+            ::close(file_descriptor);
+            if (data == MAP_FAILED) {
+                throw std::runtime_error(std::string("mapping the shared memory '") + name + "' failed");
+            }
+            _state->data = reinterpret_cast<uint8_t*>(data);
+            _state->control = reinterpret_cast<live_ring_control*>(data);
+            const auto control = _state->control;
+            if (!std::equal(std::begin(live_ring_signature), std::end(live_ring_signature), control->signature)) {
+                throw std::runtime_error(std::string("the shared memory '") + name + "' is not a live ring");
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (control->version != live_ring_version) {
+                throw std::runtime_error(std::string("the shared memory '") + name + "' uses an unsupported version");
+            }
+            if (control->slots == 0 || control->slots > live_ring_maximum_slots
+                || control->stride < control->frame_size
+                || (_state->size - frame_store_alignment) / control->stride < control->slots) {
+                throw std::runtime_error(std::string("the shared memory '") + name + "' is corrupted");
+            }
+            _read = control->released.load(std::memory_order_acquire);
+            _state->released_flags.resize(static_cast<std::size_t>(control->slots), false);
+        }
+        live_ring_reader(const live_ring_reader&) = delete;
+        live_ring_reader(live_ring_reader&&) = default;
+        live_ring_reader& operator=(const live_ring_reader&) = delete;
+        live_ring_reader& operator=(live_ring_reader&&) = default;
+        virtual ~live_ring_reader() {}
+
+        /// read returns the next published frame and its publication time (see live_ring_now), or nullptr if the
+        /// producer has not published a new frame yet.
+        virtual std::shared_ptr<const uint8_t> read(int64_t& published) {
+            const auto control = _state->control;
+            if (_read == control->written.load(std::memory_order_acquire)) {
+                return std::shared_ptr<const uint8_t>();
+            }
+            const auto slot = static_cast<std::size_t>(_read % control->slots);
+            published = control->published[slot];
+            const auto frame = _state->data + frame_store_alignment + slot * control->stride;
+            const auto frame_index = _read;
+            ++_read;
+            const auto reader_state = _state;
+            return std::shared_ptr<const uint8_t>(
+                frame, [reader_state, frame_index](const uint8_t*) { reader_state->release(frame_index); });
+        }
+
+        /// closed returns true if the producer is done and every published frame was read.
+        bool closed() const {
+            const auto control = _state->control;
+            return control->closed.load(std::memory_order_acquire) != 0
+                   && _read == control->written.load(std::memory_order_acquire);
+        }
+
+        /// format returns the layout of the frames.
+        frame_store_format format() const {
+            return _state->control->format;
+        }
+
+        /// width returns the number of columns of the display the frames were rendered for.
+        uint32_t width() const {
+            return _state->control->width;
+        }
+
+        /// height returns the number of rows of the display the frames were rendered for.
+        uint32_t height() const {
+            return _state->control->height;
+        }
+
+        /// frame_size returns the number of bytes in a frame.
+        std::size_t frame_size() const {
+            return static_cast<std::size_t>(_state->control->frame_size);
+        }
+
+        /// slots returns the number of frames in the ring.
+        std::size_t slots() const {
+            return static_cast<std::size_t>(_state->control->slots);
+        }
+
+        protected:
+        /// state holds the mapping, and is shared with the frames so that it outlives the reader if needed.
+        struct state {
+            std::mutex mutex;
+            uint8_t* data = nullptr;
+            std::size_t size = 0;
+            live_ring_control* control = nullptr;
+            std::vector<bool> released_flags;
+
+            ~state() {
+                if (data) {
+                    munmap(data, size);
+                }
+            }
+
+            /// release marks a frame as released, and returns the leading released slots to the producer.
+            void release(uint64_t frame_index) {
+                std::lock_guard<std::mutex> lock(mutex);
+                const auto slots = control->slots;
+                released_flags[static_cast<std::size_t>(frame_index % slots)] = true;
+                auto released = control->released.load(std::memory_order_relaxed);
+                while (released_flags[static_cast<std::size_t>(released % slots)]) {
+                    released_flags[static_cast<std::size_t>(released % slots)] = false;
+                    ++released;
+                }
+                control->released.store(released, std::memory_order_release);
+            }
+        };
+
+        std::shared_ptr<state> _state;
+        uint64_t _read;
+    };
+}
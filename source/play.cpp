@@ -1,18 +1,184 @@
 #include "../third_party/pontella/source/pontella.hpp"
+#include "bitplanes.hpp"
 #include "decoder.hpp"
 #include "display.hpp"
+#include "frame_cache.hpp"
+#include "frame_pool.hpp"
+#include "frame_store.hpp"
 #include "interleave.hpp"
 #include "lightcrafter.hpp"
+#include "live_ring.hpp"
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <sstream>
 #include <thread>
 
+/// frame_budget is the display duration of a 60 Hz frame, in seconds.
+const double frame_budget = 1.0 / 60.0;
+
+/// file_benchmark holds the timings of the frames decoded from one file.
+struct file_benchmark {
+    /// filename is the path of the decoded file.
+    std::string filename;
+
+    /// duration is the time elapsed between the beginning of the read and the end of the stream, in seconds.
+    double duration;
+
+    /// latencies are the times elapsed between two consecutive frames ready to be displayed, in seconds.
+    /// The first latency is measured from the beginning of the read.
+    std::vector<double> latencies;
+
+    /// interleave_durations are the CPU conversion times of the frames, in seconds (empty on the GPU path).
+    std::vector<double> interleave_durations;
+
+    /// time_to_first_frame is the time elapsed between the beginning of the read (seek included) and the first
+    /// frame, in seconds, or a negative value if no frame was decoded.
+    double time_to_first_frame;
+};
+
+/// json_string escapes and quotes a string.
+std::string json_string(const std::string& value) {
+    std::string result("\"");
+    for (const auto character : value) {
+        switch (character) {
+            case '"':
+                result.append("\\\"");
+                break;
+            case '\\':
+                result.append("\\\\");
+                break;
+            default:
+                if (static_cast<unsigned char>(character) < 0x20) {
+                    char escaped[7];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(character));
+                    result.append(escaped);
+                } else {
+                    result.push_back(character);
+                }
+        }
+    }
+    result.push_back('"');
+    return result;
+}
+
+/// json_number formats a number with a fixed precision.
+std::string json_number(double value, int precision = 3) {
+    char result[64];
+    std::snprintf(result, sizeof(result), "%.*f", precision, value);
+    return result;
+}
+
+/// percentile returns the nearest-rank percentile of sorted values.
+double percentile(const std::vector<double>& sorted_values, std::size_t rank) {
+    return sorted_values[std::max(static_cast<std::size_t>(1), (rank * sorted_values.size() + 99) / 100) - 1];
+}
+
+/// json_milliseconds returns the mean, median, 90th and 99th percentiles and maximum of sorted durations, in
+/// milliseconds, or null if there are no durations.
+std::string json_milliseconds(const std::vector<double>& sorted_durations) {
+    if (sorted_durations.empty()) {
+        return "null";
+    }
+    double sum = 0.0;
+    for (const auto duration : sorted_durations) {
+        sum += duration;
+    }
+    return std::string("{\"mean\": ") + json_number(sum / sorted_durations.size() * 1e3)
+           + ", \"p50\": " + json_number(percentile(sorted_durations, 50) * 1e3)
+           + ", \"p90\": " + json_number(percentile(sorted_durations, 90) * 1e3)
+           + ", \"p99\": " + json_number(percentile(sorted_durations, 99) * 1e3)
+           + ", \"max\": " + json_number(sorted_durations.back() * 1e3) + "}";
+}
+
+/// benchmark_json formats the benchmark of each file.
+/// The real-time factor compares the average decode rate with 60 frames per second. The headroom is the fraction of
+/// the 60 Hz budget left by the 99th percentile latency, negative values mean that bursts of slow frames must be
+/// absorbed by the buffer.
+std::string benchmark_json(const std::vector<file_benchmark>& file_benchmarks, bool gpu) {
+    std::stringstream json;
+    json << "{\n    \"mode\": \"" << (gpu ? "gpu" : "cpu") << "\",\n    \"instruction_set\": \""
+         << hummingbird::instruction_set_name(hummingbird::detect_instruction_set())
+         << "\",\n    \"budget_ms\": " << json_number(frame_budget * 1e3) << ",\n    \"files\": [";
+    for (std::size_t index = 0; index < file_benchmarks.size(); ++index) {
+        const auto& benchmark = file_benchmarks[index];
+        auto latencies = benchmark.latencies;
+        std::sort(latencies.begin(), latencies.end());
+        auto interleave_durations = benchmark.interleave_durations;
+        std::sort(interleave_durations.begin(), interleave_durations.end());
+        const auto realtime_factor =
+            benchmark.duration > 0.0 ? latencies.size() / benchmark.duration * frame_budget : 0.0;
+        json << (index == 0 ? "\n" : ",\n") << "        {\n"
+             << "            \"filename\": " << json_string(benchmark.filename) << ",\n"
+             << "            \"frames\": " << latencies.size() << ",\n"
+             << "            \"duration_s\": " << json_number(benchmark.duration) << ",\n"
+             << "            \"time_to_first_frame_ms\": "
+             << (benchmark.time_to_first_frame < 0.0 ? std::string("null")
+                                                     : json_number(benchmark.time_to_first_frame * 1e3))
+             << ",\n"
+             << "            \"decode_frames_per_second\": " << json_number(realtime_factor / frame_budget, 1) << ",\n"
+             << "            \"realtime_factor\": " << json_number(realtime_factor) << ",\n"
+             << "            \"interleave_ms\": " << json_milliseconds(interleave_durations) << ",\n"
+             << "            \"latency_ms\": " << json_milliseconds(latencies) << ",\n"
+             << "            \"headroom\": "
+             << (latencies.empty() ? std::string("null")
+                                   : json_number(1.0 - percentile(latencies, 99) / frame_budget))
+             << ",\n"
+             << "            \"realtime\": " << (realtime_factor >= 1.0 ? "true" : "false") << "\n"
+             << "        }";
+    }
+    json << (file_benchmarks.empty() ? "]\n}\n" : "\n    ]\n}\n");
+    return json.str();
+}
+
+/// benchmark decodes and converts the frames [start_frame, end_frame) of each file as fast as possible, without a
+/// display, and prints a JSON report.
+void benchmark(const std::vector<std::string>& filenames, std::size_t start_frame, std::size_t end_frame, bool gpu) {
+    std::vector<file_benchmark> file_benchmarks;
+    file_benchmarks.reserve(filenames.size());
+    std::vector<uint8_t> rgbs(hummingbird::lightcrafter_1440_hz::frame_size);
+    auto previous = std::chrono::steady_clock::now();
+    auto decoder = hummingbird::make_decoder([&](const Glib::RefPtr<Gst::Buffer>& buffer) {
+        if (gpu) {
+            hummingbird::share_frame(buffer);
+        } else {
+            const auto begin = std::chrono::steady_clock::now();
+            hummingbird::interleave(buffer, rgbs.data());
+            file_benchmarks.back().interleave_durations.push_back(
+                std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - begin)
+                    .count());
+        }
+        const auto now = std::chrono::steady_clock::now();
+        file_benchmarks.back().latencies.push_back(
+            std::chrono::duration_cast<std::chrono::duration<double>>(now - previous).count());
+        previous = now;
+    });
+    for (const auto& filename : filenames) {
+        file_benchmarks.push_back(file_benchmark{filename, 0.0, {}, {}, -1.0});
+        previous = std::chrono::steady_clock::now();
+        const auto begin = previous;
+        decoder->read(filename, start_frame, end_frame);
+        file_benchmarks.back().duration =
+            std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - begin)
+                .count();
+        file_benchmarks.back().time_to_first_frame = decoder->time_to_first_frame() / 1e6;
+    }
+    std::cout << benchmark_json(file_benchmarks, gpu);
+    std::cout.flush();
+}
+
 int main(int argc, char* argv[]) {
     return pontella::main(
         {
             "play reads one or several video files and displays them with a "
             "LightCrafter",
+            "    each path may point to a MP4 file, a frame store created by prerender,",
+            "    or a bit-plane video created by generate with the option 'bitplanes'",
+            "    frames can also be read from a live ring created by another process",
             "Syntax: ./play [options] /path/to/first/video.mp4 "
             "[/path/to/second/video.mp4...]",
             "Available options:",
@@ -37,20 +203,70 @@ int main(int argc, char* argv[]) {
             "                                          however, small buffers "
             "increase the risk",
             "                                          to miss frames",
+            "    -d [bits], --depth [bits]         sets the number of bits per "
+            "pattern",
+            "                                          1 (1440 Hz), 2 (720 Hz), 4 "
+            "(360 Hz) or 8 (180 Hz)",
+            "                                          must match the value used "
+            "to generate the videos",
+            "                                          defaults to 1",
+            "                                          ignored in windowed mode",
             "    -i [ip], --ip [ip]                sets the LightCrafter IP "
             "address",
             "                                          defaults to 10.10.10.100",
             "                                          ignored in windowed mode",
+            "    -g, --gpu                         converts the decoded frames to RGB",
+            "                                          in the fragment shader instead of the CPU",
+            "                                          the displayed frames are identical",
+            "    -c [megabytes], --cache [megabytes]",
+            "                                          keeps the frames of played files in memory",
+            "                                          so that repeated files are not decoded again",
+            "                                          the least recently played files are evicted",
+            "                                          to stay within the given budget",
+            "                                          disabled by default",
+            "    -s [frame], --start [frame]       starts each file at the given 60 Hz frame",
+            "                                          videos seek to the previous key frame",
+            "                                          and decode the frames before the start",
+            "                                          without displaying them, defaults to 0",
+            "                                          the seek and preroll time, and the time from",
+            "                                          the start of playback to the first queued frame",
+            "                                          are printed after each video",
+            "    -e [frame], --end [frame]         stops each file before the given 60 Hz frame",
+            "                                          defaults to the end of the file",
+            "    -r [name], --ring [name]          displays the frames of the shared-memory live ring 'name'",
+            "                                          (for instance created by generate with the option 'ring')",
+            "                                          instead of files, until the producer closes it",
+            "                                          RGB frames require the default mode and I420 frames",
+            "                                          require --gpu to be displayed without a copy",
+            "                                          the publish-to-swap latencies are printed as JSON",
+            "                                          use a small buffer (for instance 2) to reduce them",
+            "    -m, --benchmark                   decodes and converts the files as fast as possible",
+            "                                          without a display or a LightCrafter, and prints",
+            "                                          the throughput and latencies of each file as JSON",
+            "                                          compatible with --gpu, --start and --end,",
+            "                                          the other flags are ignored",
             "    -h, --help                        shows this help message",
         },
         argc,
         argv,
         -1,
-        {{"prefer", {"p"}}, {"buffer", {"b"}}, {"ip", {"i"}}},
-        {{"loop", {"l"}}, {"windowed", {"w"}}},
+        {{"prefer", {"p"}},
+         {"buffer", {"b"}},
+         {"depth", {"d"}},
+         {"ip", {"i"}},
+         {"cache", {"c"}},
+         {"start", {"s"}},
+         {"end", {"e"}},
+         {"ring", {"r"}}},
+        {{"benchmark", {"m"}}, {"gpu", {"g"}}, {"loop", {"l"}}, {"windowed", {"w"}}},
         [](pontella::command command) {
-            if (command.arguments.empty()) {
-                throw std::runtime_error("at least one video path is required");
+            const auto ring_name_and_value = command.options.find("ring");
+            if (ring_name_and_value == command.options.end()) {
+                if (command.arguments.empty()) {
+                    throw std::runtime_error("at least one video path is required");
+                }
+            } else if (!command.arguments.empty()) {
+                throw std::runtime_error("video paths cannot be used with the option 'ring'");
             }
             for (const auto& filename : command.arguments) {
                 std::ifstream input(filename);
@@ -58,6 +274,31 @@ int main(int argc, char* argv[]) {
                     throw std::runtime_error(std::string("'") + filename + "' could not be open for reading");
                 }
             }
+            std::size_t start_frame = 0;
+            {
+                const auto name_and_value = command.options.find("start");
+                if (name_and_value != command.options.end()) {
+                    start_frame = std::stoull(name_and_value->second);
+                }
+            }
+            auto end_frame = std::numeric_limits<std::size_t>::max();
+            {
+                const auto name_and_value = command.options.find("end");
+                if (name_and_value != command.options.end()) {
+                    end_frame = std::stoull(name_and_value->second);
+                }
+            }
+            if (end_frame <= start_frame) {
+                throw std::runtime_error("the end frame must be larger than the start frame");
+            }
+            if (command.flags.find("benchmark") != command.flags.end()) {
+                if (ring_name_and_value != command.options.end()) {
+                    throw std::runtime_error("the flag 'benchmark' is not compatible with the option 'ring'");
+                }
+                benchmark(
+                    command.arguments, start_frame, end_frame, command.flags.find("gpu") != command.flags.end());
+                return;
+            }
             std::size_t prefer = 0;
             {
                 const auto name_and_value = command.options.find("prefer");
@@ -79,17 +320,78 @@ int main(int argc, char* argv[]) {
                     ip = hummingbird::lightcrafter::parse_ip(name_and_value->second);
                 }
             }
+            std::vector<hummingbird::lightcrafter::setting> settings;
+            {
+                std::size_t bits_per_pattern = 1;
+                const auto name_and_value = command.options.find("depth");
+                if (name_and_value != command.options.end()) {
+                    bits_per_pattern = std::stoull(name_and_value->second);
+                }
+                switch (bits_per_pattern) {
+                    case 1:
+                        settings =
+                            hummingbird::lightcrafter::high_framerate_settings<hummingbird::lightcrafter_1440_hz>();
+                        break;
+                    case 2:
+                        settings =
+                            hummingbird::lightcrafter::high_framerate_settings<hummingbird::lightcrafter_720_hz>();
+                        break;
+                    case 4:
+                        settings =
+                            hummingbird::lightcrafter::high_framerate_settings<hummingbird::lightcrafter_360_hz>();
+                        break;
+                    case 8:
+                        settings =
+                            hummingbird::lightcrafter::high_framerate_settings<hummingbird::lightcrafter_180_hz>();
+                        break;
+                    default:
+                        throw std::runtime_error("the number of bits per pattern must be 1, 2, 4 or 8");
+                }
+            }
             std::unique_ptr<hummingbird::lightcrafter> lightcrafter;
             if (command.flags.find("windowed") == command.flags.end()) {
-                lightcrafter.reset(new hummingbird::lightcrafter(ip));
+                lightcrafter.reset(new hummingbird::lightcrafter(ip, settings));
+            }
+            const auto gpu = command.flags.find("gpu") != command.flags.end();
+            std::unique_ptr<hummingbird::live_ring_reader> live_ring;
+            if (ring_name_and_value != command.options.end()) {
+                live_ring.reset(new hummingbird::live_ring_reader(ring_name_and_value->second));
+                if (live_ring->format() == hummingbird::frame_store_format::rgb && gpu) {
+                    throw std::runtime_error(
+                        std::string("the live ring '") + ring_name_and_value->second
+                        + "' holds rgb frames, which are not compatible with the flag 'gpu'");
+                }
+                if (live_ring->width() != hummingbird::lightcrafter_1440_hz::width
+                    || live_ring->height() != hummingbird::lightcrafter_1440_hz::height
+                    || live_ring->frame_size() != hummingbird::lightcrafter_1440_hz::frame_size) {
+                    throw std::runtime_error(
+                        std::string("the live ring '") + ring_name_and_value->second
+                        + "' was not created for the LightCrafter");
+                }
+            }
+            // the publication time of each frame in the FIFO (or being displayed), indexed by frame id,
+            // and the time elapsed between the publication and the swap of each displayed live frame
+            std::vector<int64_t> published_times(live_ring ? fifo_size + 2 : 0, 0);
+            std::vector<double> live_latencies;
+            std::unique_ptr<hummingbird::frame_cache> cache;
+            {
+                const auto name_and_value = command.options.find("cache");
+                if (name_and_value != command.options.end()) {
+                    cache.reset(new hummingbird::frame_cache(std::stoull(name_and_value->second) * 1000000));
+                }
             }
             auto display = hummingbird::make_display(
                 command.flags.find("windowed") != command.flags.end(),
-                608,
-                684,
+                hummingbird::lightcrafter_1440_hz::width,
+                hummingbird::lightcrafter_1440_hz::height,
                 prefer,
                 fifo_size,
-                [](hummingbird::display_event display_event) {
+                [&](hummingbird::display_event display_event) {
+                    if (display_event.has_id && !published_times.empty()) {
+                        live_latencies.push_back(
+                            (hummingbird::live_ring_now() - published_times[display_event.id % published_times.size()])
+                            / 1e9);
+                    }
                     if (display_event.empty_fifo) {
                         std::cout << "warning: empty fifo\n";
                     } else if (
@@ -99,13 +401,13 @@ int main(int argc, char* argv[]) {
                                          + std::to_string(display_event.loop_duration) + " microseconds)\n";
                     }
                     std::cout.flush();
-                });
+                },
+                gpu ? hummingbird::display_format::i420 : hummingbird::display_format::rgb);
             std::size_t index = 0;
             auto started = false;
-            std::vector<uint8_t> data;
+            hummingbird::frame_pool pool(hummingbird::lightcrafter_1440_hz::frame_size, fifo_size + 1);
             std::atomic_bool running(true);
-            auto decoder = hummingbird::make_decoder([&](const Glib::RefPtr<Gst::Buffer>& buffer) {
-                hummingbird::interleave(buffer, data);
+            const auto push = [&](std::shared_ptr<const uint8_t>& data) {
                 while (running.load(std::memory_order_acquire)) {
                     if (display->push(data, index)) {
                         ++index;
@@ -118,28 +420,244 @@ int main(int argc, char* argv[]) {
                         std::this_thread::sleep_for(std::chrono::milliseconds(20));
                     }
                 }
-            });
+            };
+            const auto acquire = [&]() {
+                std::shared_ptr<uint8_t> bytes;
+                while (!(bytes = pool.acquire()) && running.load(std::memory_order_acquire)) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                return bytes;
+            };
+            std::shared_ptr<hummingbird::frame_cache::clip> recording;
+            const auto handle_frame = [&](const Glib::RefPtr<Gst::Buffer>& buffer) {
+                std::shared_ptr<const uint8_t> data;
+                if (gpu) {
+                    data = hummingbird::share_frame(buffer);
+                } else {
+                    auto rgbs = acquire();
+                    if (!rgbs) {
+                        return;
+                    }
+                    hummingbird::interleave(buffer, rgbs.get());
+                    data = std::move(rgbs);
+                }
+                if (recording) {
+                    if ((recording->frames.size() + 1) * hummingbird::lightcrafter_1440_hz::frame_size
+                        > cache->budget()) {
+                        recording.reset();
+                    } else {
+                        recording->frames.emplace_back(
+                            data.get(), data.get() + hummingbird::lightcrafter_1440_hz::frame_size);
+                    }
+                }
+                push(data);
+            };
+            // two decoders alternate, so that the next file is prerolled while the current one plays
+            // only the playing decoder calls handle_frame, and cached files skip the decoders
+            std::array<decltype(hummingbird::make_decoder(handle_frame)), 2> decoders{
+                {hummingbird::make_decoder(handle_frame), hummingbird::make_decoder(handle_frame)}};
+            // returns the frame after the last frame of the range, and checks that the range starts within the file
+            const auto range_end = [&](const std::string& filename, std::size_t frames) {
+                if (start_frame >= frames) {
+                    throw std::runtime_error(
+                        std::string("'") + filename + "' has " + std::to_string(frames)
+                        + " frames, hence it cannot start at frame " + std::to_string(start_frame));
+                }
+                return std::min(end_frame, frames);
+            };
+            const auto find_clip = [&](const std::string& filename) {
+                return cache ? cache->find(filename) : std::shared_ptr<const hummingbird::frame_cache::clip>();
+            };
+            const auto open_store = [&](const std::string& filename) {
+                if (!hummingbird::is_frame_store(filename)) {
+                    return std::shared_ptr<const hummingbird::frame_store>();
+                }
+                std::shared_ptr<const hummingbird::frame_store> store(new hummingbird::frame_store(filename));
+                const auto format = gpu ? hummingbird::frame_store_format::i420 : hummingbird::frame_store_format::rgb;
+                if (store->format() != format) {
+                    throw std::runtime_error(
+                        std::string("'") + filename + "' holds " + hummingbird::frame_store_format_name(store->format())
+                        + " frames, whereas the display expects " + hummingbird::frame_store_format_name(format)
+                        + " frames (see the flag 'gpu')");
+                }
+                if (store->width() != hummingbird::lightcrafter_1440_hz::width
+                    || store->height() != hummingbird::lightcrafter_1440_hz::height
+                    || store->frame_size() != hummingbird::lightcrafter_1440_hz::frame_size) {
+                    throw std::runtime_error(std::string("'") + filename + "' was not rendered for the LightCrafter");
+                }
+                range_end(filename, store->frames());
+                store->prefetch(start_frame, fifo_size);
+                return store;
+            };
+            const auto open_bitplanes = [&](const std::string& filename) {
+                if (!hummingbird::is_bitplanes(filename)) {
+                    return std::shared_ptr<hummingbird::bitplanes_reader>();
+                }
+                std::shared_ptr<hummingbird::bitplanes_reader> reader(new hummingbird::bitplanes_reader(filename));
+                if (reader->width() != hummingbird::lightcrafter_1440_hz::width
+                    || reader->height() != hummingbird::lightcrafter_1440_hz::height
+                    || reader->frame_size() != hummingbird::lightcrafter_1440_hz::frame_size) {
+                    throw std::runtime_error(std::string("'") + filename + "' was not packed for the LightCrafter");
+                }
+                if (start_frame > 0) {
+                    reader->seek(start_frame);
+                }
+                return reader;
+            };
             std::exception_ptr play_exception;
             std::thread play_loop([&]() {
                 try {
+                    if (live_ring) {
+                        // frames are displayed as soon as they are published, ring slots are returned to the
+                        // producer once uploaded (or once interleaved to a pooled buffer without --gpu)
+                        while (running.load(std::memory_order_acquire) && !live_ring->closed()) {
+                            int64_t published = 0;
+                            auto bytes = live_ring->read(published);
+                            if (!bytes) {
+                                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                                continue;
+                            }
+                            std::shared_ptr<const uint8_t> data;
+                            if (live_ring->format() == hummingbird::frame_store_format::i420 && !gpu) {
+                                auto frame = acquire();
+                                if (!frame) {
+                                    break;
+                                }
+                                hummingbird::interleave<hummingbird::lightcrafter_1440_hz>(bytes.get(), frame.get());
+                                bytes.reset();
+                                data = std::move(frame);
+                            } else {
+                                data = std::move(bytes);
+                            }
+                            published_times[index % published_times.size()] = published;
+                            push(data);
+                            if (!started) {
+                                started = true;
+                                display->start();
+                            }
+                        }
+                        display->close();
+                        return;
+                    }
                     const auto loop = command.flags.find("loop") != command.flags.end();
                     std::size_t video_index = 0;
-                    while (running.load(std::memory_order_acquire)) {
+                    auto store = open_store(command.arguments[0]);
+                    auto bitplanes = store ? nullptr : open_bitplanes(command.arguments[0]);
+                    auto clip = (store || bitplanes) ? nullptr : find_clip(command.arguments[0]);
+                    if (!store && !bitplanes && !clip) {
+                        decoders[0]->open(command.arguments[0], start_frame, end_frame);
+                    }
+                    for (std::size_t decoder_index = 0; running.load(std::memory_order_acquire);
+                         decoder_index = 1 - decoder_index) {
+                        auto next_video_index = video_index + 1;
+                        if (next_video_index >= command.arguments.size()) {
+                            next_video_index = loop ? 0 : command.arguments.size();
+                        }
+                        std::shared_ptr<const hummingbird::frame_store> next_store;
+                        std::shared_ptr<hummingbird::bitplanes_reader> next_bitplanes;
+                        std::shared_ptr<const hummingbird::frame_cache::clip> next_clip;
+                        std::exception_ptr open_exception;
+                        std::thread open_loop;
+                        if (next_video_index < command.arguments.size()) {
+                            next_store = open_store(command.arguments[next_video_index]);
+                            if (!next_store) {
+                                next_bitplanes = open_bitplanes(command.arguments[next_video_index]);
+                            }
+                            if (!next_store && !next_bitplanes) {
+                                next_clip = find_clip(command.arguments[next_video_index]);
+                            }
+                            if (!next_store && !next_bitplanes && !next_clip) {
+                                open_loop = std::thread([&]() {
+                                    try {
+                                        decoders[1 - decoder_index]->open(
+                                            command.arguments[next_video_index], start_frame, end_frame);
+                                    } catch (...) {
+                                        open_exception = std::current_exception();
+                                    }
+                                });
+                            }
+                        }
                         std::cout << std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(
                                                         std::chrono::system_clock::now().time_since_epoch())
                                                         .count())
                                          + " " + command.arguments[video_index] + "\n";
                         std::cout.flush();
-                        decoder->read(command.arguments[video_index]);
-                        ++video_index;
-                        if (video_index >= command.arguments.size()) {
-                            if (loop) {
-                                video_index = 0;
+                        try {
+                            if (store) {
+                                // frames are read ahead one buffer in advance, while earlier frames wait in the FIFO
+                                const auto end = range_end(command.arguments[video_index], store->frames());
+                                for (auto frame_index = start_frame; frame_index < end; ++frame_index) {
+                                    store->prefetch(frame_index + fifo_size, 1);
+                                    std::shared_ptr<const uint8_t> data(store, store->frame(frame_index));
+                                    push(data);
+                                }
+                            } else if (bitplanes) {
+                                // decoded frames are converted (or copied in GPU mode) to pooled buffers
+                                // the reader was moved to the start frame when opened
+                                const auto end = range_end(command.arguments[video_index], bitplanes->frames());
+                                for (auto frame_index = start_frame; frame_index < end; ++frame_index) {
+                                    const auto bytes = bitplanes->read();
+                                    auto frame = acquire();
+                                    if (!frame) {
+                                        break;
+                                    }
+                                    if (gpu) {
+                                        std::copy(
+                                            bytes,
+                                            bytes + hummingbird::lightcrafter_1440_hz::frame_size,
+                                            frame.get());
+                                    } else {
+                                        hummingbird::interleave<hummingbird::lightcrafter_1440_hz>(bytes, frame.get());
+                                    }
+                                    std::shared_ptr<const uint8_t> data(std::move(frame));
+                                    push(data);
+                                }
+                            } else if (clip) {
+                                const auto end = range_end(command.arguments[video_index], clip->frames.size());
+                                for (auto frame_index = start_frame; frame_index < end; ++frame_index) {
+                                    std::shared_ptr<const uint8_t> data(clip, clip->frames[frame_index].data());
+                                    push(data);
+                                }
                             } else {
-                                display->close();
-                                break;
+                                // partial ranges are not cached, since the cache holds whole files
+                                if (cache && start_frame == 0 && end_frame == std::numeric_limits<std::size_t>::max()) {
+                                    recording = hummingbird::frame_cache::make_clip(command.arguments[video_index]);
+                                }
+                                decoders[decoder_index]->play();
+                                if (start_frame > 0 && decoders[decoder_index]->time_to_first_frame() >= 0) {
+                                    // the seek runs in open, while the previous file plays (or before the first file)
+                                    std::cout << command.arguments[video_index] + ": seek and preroll in "
+                                                     + std::to_string(decoders[decoder_index]->open_duration())
+                                                     + " microseconds, first frame queued "
+                                                     + std::to_string(decoders[decoder_index]->time_to_first_frame())
+                                                     + " microseconds after the start of playback\n";
+                                    std::cout.flush();
+                                }
+                                if (recording && running.load(std::memory_order_acquire)) {
+                                    cache->insert(recording);
+                                }
+                                recording.reset();
+                            }
+                        } catch (...) {
+                            if (open_loop.joinable()) {
+                                open_loop.join();
                             }
+                            throw;
                         }
+                        if (open_loop.joinable()) {
+                            open_loop.join();
+                            if (open_exception) {
+                                std::rethrow_exception(open_exception);
+                            }
+                        }
+                        if (next_video_index >= command.arguments.size()) {
+                            display->close();
+                            break;
+                        }
+                        video_index = next_video_index;
+                        store = std::move(next_store);
+                        bitplanes = std::move(next_bitplanes);
+                        clip = std::move(next_clip);
                     }
                 } catch (...) {
                     play_exception = std::current_exception();
@@ -148,10 +666,17 @@ int main(int argc, char* argv[]) {
             });
             display->run();
             running.store(false, std::memory_order_release);
-            decoder->stop();
+            for (auto& decoder : decoders) {
+                decoder->stop();
+            }
             play_loop.join();
             if (play_exception) {
                 std::rethrow_exception(play_exception);
             }
+            if (live_ring) {
+                std::sort(live_latencies.begin(), live_latencies.end());
+                std::cout << std::string("live latency (ms): ") + json_milliseconds(live_latencies) + "\n";
+                std::cout.flush();
+            }
         });
 }
@@ -0,0 +1,65 @@
+#include "../third_party/pontella/source/pontella.hpp"
+#include "decoder.hpp"
+#include "frame_store.hpp"
+#include "interleave.hpp"
+#include <fstream>
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+    return pontella::main(
+        {
+            "prerender decodes a video once and writes its frames to a frame store",
+            "    play reads frame stores in place with mmap, without a decoder",
+            "    frames are aligned on 4096-byte pages, and a store takes about 1.2 MB per frame",
+            "Syntax: ./prerender [options] /path/to/video.mp4 /path/to/output.hbf",
+            "Available options:",
+            "    -g, --gpu     stores the decoded YUV420 frames instead of RGB frames",
+            "                      the store must then be played with the flag 'gpu'",
+            "    -h, --help    shows this help message",
+        },
+        argc,
+        argv,
+        2,
+        {},
+        {{"gpu", {"g"}}},
+        [](pontella::command command) {
+            using device = hummingbird::lightcrafter_1440_hz;
+            const auto gpu = command.flags.find("gpu") != command.flags.end();
+            {
+                std::ifstream input(command.arguments[0]);
+                if (!input.good()) {
+                    throw std::runtime_error(
+                        std::string("'") + command.arguments[0] + "' could not be open for reading");
+                }
+            }
+            hummingbird::frame_store_writer writer(
+                command.arguments[1],
+                gpu ? hummingbird::frame_store_format::i420 : hummingbird::frame_store_format::rgb,
+                device::width,
+                device::height,
+                device::frame_size);
+            std::vector<uint8_t> rgbs(device::frame_size);
+            std::exception_ptr write_exception;
+            auto decoder = hummingbird::make_decoder([&](const Glib::RefPtr<Gst::Buffer>& buffer) {
+                if (write_exception) {
+                    return;
+                }
+                try {
+                    if (gpu) {
+                        writer.write(hummingbird::share_frame<device>(buffer).get());
+                    } else {
+                        hummingbird::interleave<device>(buffer, rgbs.data());
+                        writer.write(rgbs.data());
+                    }
+                } catch (...) {
+                    write_exception = std::current_exception();
+                }
+            });
+            decoder->read(command.arguments[0]);
+            if (write_exception) {
+                std::rethrow_exception(write_exception);
+            }
+            writer.close();
+            std::cout << std::to_string(writer.frames()) + " frames written to " + command.arguments[1] + "\n";
+        });
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "rotate.hpp"
+#include <cstdint>
+#include <stdexcept>
+
+/// hummingbird bundles tools to create and play high framerate videos.
+namespace hummingbird {
+    /// psychopy_pattern_channel returns the channel written by the given pattern in the layout used by
+    /// psychopy/hummingbird.py: 0 and 1 are the even and odd Y bytes, 2 is the U and V planes (even device rows
+    /// in U, odd device rows in V). Each channel receives 8 consecutive patterns, starting with channel 2.
+    inline uint8_t psychopy_pattern_channel(std::size_t pattern) {
+        return static_cast<uint8_t>((pattern / 8 + 2) % 3);
+    }
+
+    /// psychopy_pattern_mask returns the bit written by the given pattern in the layout used by
+    /// psychopy/hummingbird.py.
+    inline uint8_t psychopy_pattern_mask(std::size_t pattern) {
+        return static_cast<uint8_t>(1 << (pattern % 8));
+    }
+
+    /// psychopy_byte returns the YUV420 frame byte which holds the given channel of a device pixel, in the layout
+    /// used by psychopy/hummingbird.py.
+    template <typename Device>
+    inline uint8_t& psychopy_byte(uint8_t* frame, uint8_t channel, std::size_t row, std::size_t column) {
+        if (channel == 2) {
+            return frame[Device::pixels * 2 + ((row % 2) * (Device::height / 2) + row / 2) * Device::width + column];
+        }
+        return frame[(row * Device::width + column) * 2 + channel];
+    }
+
+    /// insert_psychopy_pattern rotates a diamond<Device> grey pattern (rows stride bytes apart), and writes its
+    /// thresholds (a grey level larger than 127 means ON) to the bit planes of the given pattern in a YUV420 frame.
+    /// The other bits are left unchanged.
+    template <typename Device = lightcrafter_1440_hz>
+    inline void
+    insert_psychopy_pattern(const uint8_t* greys, std::size_t stride, uint8_t* frame, std::size_t pattern) {
+        if (pattern >= Device::patterns_per_frame || Device::bits_per_pattern != 1) {
+            throw std::logic_error("the PsychoPy layout requires binary patterns");
+        }
+        if (stride < diamond<Device>::width) {
+            throw std::logic_error("the stride must be larger than or equal to the diamond width");
+        }
+        const auto channel = psychopy_pattern_channel(pattern);
+        const auto mask = psychopy_pattern_mask(pattern);
+        const uint8_t inverse_mask = ~mask;
+        for (std::size_t row = 0; row < Device::height; ++row) {
+            auto source = greys
+                          + (row <= diamond<Device>::side ? diamond<Device>::side - row
+                                                          : (row - diamond<Device>::side) * stride);
+            auto target = &psychopy_byte<Device>(frame, channel, row, diamond<Device>::offset);
+            const std::size_t step = channel == 2 ? 1 : 2;
+            for (auto column = diamond<Device>::begin(row); column < diamond<Device>::end(row); ++column) {
+                const uint8_t on = -static_cast<uint8_t>(*source >> 7);
+                target[column * step] = (target[column * step] & inverse_mask) | (on & mask);
+                source += stride + 1;
+            }
+        }
+    }
+
+    /// fill_psychopy_corner sets every bit of a channel's top-right corner triangle to value.
+    /// psychopy/hummingbird.py uses the corner to display synchronization patterns.
+    template <typename Device = lightcrafter_1440_hz>
+    inline void fill_psychopy_corner(uint8_t* frame, uint8_t channel, uint8_t value, std::size_t corner_size) {
+        if (channel > 2) {
+            throw std::logic_error("the channel must be 0, 1 or 2");
+        }
+        if (corner_size * 2 > Device::height || corner_size + 1 > Device::width) {
+            throw std::logic_error("the corner is too large");
+        }
+        for (std::size_t row = 0; row < corner_size * 2; ++row) {
+            for (auto column = Device::width - (corner_size + 1 - (row + 1) / 2); column < Device::width; ++column) {
+                psychopy_byte<Device>(frame, channel, row, column) = value;
+            }
+        }
+    }
+}
@@ -1,22 +1,85 @@
 #pragma once
 
+#include "device.hpp"
 #include <cstdint>
+#include <stdexcept>
 #include <vector>
 
 /// hummingbird bundles tools to create and play high framerate videos.
 namespace hummingbird {
-    /// rotate converts a 343 x 342 RGB frame to a 608 x 684 RGB frame.
+    /// diamond describes the diamond pixel arrangement of a DMD (343 x 342 for the LightCrafter).
+    /// A diamond pixel (x, y) is displayed at column offset + (x + y) / 2 and row side - x + y of the device.
+    /// Along a device row, consecutive columns map to diamond pixels source_step apart.
+    template <typename Device>
+    struct diamond {
+        /// side is the number of rows of a diamond frame.
+        static constexpr std::size_t side = Device::height / 2;
+
+        /// width is the number of columns of a diamond frame.
+        static constexpr std::size_t width = side + 1;
+
+        /// height is the number of rows of a diamond frame.
+        static constexpr std::size_t height = side;
+
+        /// pixels is the number of pixels in a diamond frame.
+        static constexpr std::size_t pixels = width * height;
+
+        /// offset is the device column of the diamond's left corner.
+        static constexpr std::size_t offset = (Device::width - side) / 2;
+
+        /// source_step is the distance between the diamond pixels of consecutive columns in a device row.
+        static constexpr std::size_t source_step = width + 1;
+
+        /// parity returns the parity of x + y for the diamond pixels displayed on the given device row.
+        static constexpr std::size_t parity(std::size_t row) {
+            return (row + side) % 2;
+        }
+
+        /// begin returns the first diamond column (relative to offset) covered by the given device row.
+        static constexpr std::size_t begin(std::size_t row) {
+            return ((row > side ? row - side : side - row) - parity(row)) / 2;
+        }
+
+        /// end returns the diamond column (relative to offset) following the last one covered by the given device row.
+        static constexpr std::size_t end(std::size_t row) {
+            return (row < side - 1 ? side + row - parity(row) : 3 * side - 2 - row - parity(row)) / 2 + 1;
+        }
+
+        /// source returns the index of the diamond pixel displayed at column begin(row) of the given device row.
+        static constexpr std::size_t source(std::size_t row) {
+            return row <= side ? side - row : (row - side) * width;
+        }
+    };
+
+    template <typename Device>
+    constexpr std::size_t diamond<Device>::side;
+    template <typename Device>
+    constexpr std::size_t diamond<Device>::width;
+    template <typename Device>
+    constexpr std::size_t diamond<Device>::height;
+    template <typename Device>
+    constexpr std::size_t diamond<Device>::pixels;
+    template <typename Device>
+    constexpr std::size_t diamond<Device>::offset;
+    template <typename Device>
+    constexpr std::size_t diamond<Device>::source_step;
+
+    /// rotate converts a diamond<Device>::width x diamond<Device>::height RGB frame to a Device::width x
+    /// Device::height RGB frame, following the diamond pixel arrangement of the DMD.
+    template <typename Device = lightcrafter_1440_hz>
     inline void rotate(const std::vector<uint8_t>& input, std::vector<uint8_t>& output) {
-        if (input.size() != 343 * 342 * 3) {
+        if (input.size() != diamond<Device>::pixels * 3) {
             throw std::logic_error("unexpected rotate input size");
         }
-        output.resize(608 * 684 * 3, 0);
-        for (uint16_t y = 0; y < 342; ++y) {
-            for (uint16_t x = 0; x < 343; ++x) {
-                for (uint8_t channel = 0; channel < 3; ++channel) {
-                    output[(133 + (x + y) / 2 + (342 - x + y) * 608) * 3 + channel] =
-                        input[(x + y * 343) * 3 + channel];
-                }
+        output.resize(Device::frame_size, 0);
+        for (std::size_t row = 0; row < Device::height; ++row) {
+            auto source = diamond<Device>::source(row) * 3;
+            auto target = (row * Device::width + diamond<Device>::offset) * 3;
+            for (auto column = diamond<Device>::begin(row); column < diamond<Device>::end(row); ++column) {
+                output[target + column * 3] = input[source];
+                output[target + column * 3 + 1] = input[source + 1];
+                output[target + column * 3 + 2] = input[source + 2];
+                source += diamond<Device>::source_step * 3;
             }
         }
     }
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "deinterleave.hpp"
+#include "rotate.hpp"
+#include <algorithm>
+#include <cstring>
+
+/// hummingbird bundles tools to create and play high framerate videos.
+namespace hummingbird {
+    /// rotate_block_rows is the number of diamond rows packed at once by rotate_deinterleave_group.
+    /// It must be a multiple of 8, so that bit blocks start on a byte boundary.
+    constexpr std::size_t rotate_block_rows = 32;
+
+    /// rotate_deinterleave_group packs Device::patterns_per_frame / replicates consecutive diamond patterns into a
+    /// YUV420 frame, following the diamond pixel arrangement of the DMD. Each diamond pattern is displayed
+    /// replicates times in a row.
+    /// Blocks of rotate_block_rows diamond rows are packed in diamond order into a small buffer with the insert
+    /// kernels, then each packed pixel is written once at its device position.
+    template <typename Device = lightcrafter_1440_hz>
+    inline void rotate_deinterleave_group(
+        instruction_set set,
+        bool bit_input,
+        const uint8_t* bytes,
+        uint8_t* frame,
+        std::size_t replicates = 1) {
+        constexpr std::size_t block_pixels = diamond<Device>::width * rotate_block_rows;
+        const std::size_t pattern_size = bit_input ? (diamond<Device>::pixels + 7) / 8 : diamond<Device>::pixels;
+        uint8_t channels[3][block_pixels];
+        std::memset(frame, 0, Device::frame_size);
+        for (std::size_t first_y = 0; first_y < diamond<Device>::height; first_y += rotate_block_rows) {
+            const auto rows = std::min(rotate_block_rows, diamond<Device>::height - first_y);
+            const auto count = diamond<Device>::width * rows;
+            const auto offset = diamond<Device>::width * first_y;
+            std::memset(channels, 0, sizeof(channels));
+            for (std::size_t first = 0; first < Device::patterns_per_frame; first += replicates) {
+                const auto pattern_bytes = bytes + (first / replicates) * pattern_size;
+                for (uint8_t channel = 0; channel < 3; ++channel) {
+                    uint8_t mask = 0;
+                    for (auto pattern = first; pattern < first + replicates; ++pattern) {
+                        if (Device::pattern_channel(pattern) == channel) {
+                            mask |= Device::pattern_mask(pattern);
+                        }
+                    }
+                    if (mask == 0) {
+                        continue;
+                    }
+                    if (bit_input) {
+                        insert_bits(set, pattern_bytes + offset / 8, channels[channel], count, mask);
+                    } else if (Device::bits_per_pattern == 1) {
+                        insert_thresholds(set, pattern_bytes + offset, channels[channel], count, mask);
+                    } else {
+                        insert_fields(
+                            set, pattern_bytes + offset, channels[channel], count, mask, Device::bits_per_pattern);
+                    }
+                }
+            }
+            for (std::size_t y = 0; y < rows; ++y) {
+                for (std::size_t x = 0; x < diamond<Device>::width; ++x) {
+                    const auto row = diamond<Device>::side - x + first_y + y;
+                    const auto column = diamond<Device>::offset + (x + first_y + y) / 2;
+                    const auto index = y * diamond<Device>::width + x;
+                    frame[(row * Device::width + column) * 2] = channels[1][index];
+                    frame[(row * Device::width + column) * 2 + 1] = channels[2][index];
+                    frame
+                        [Device::pixels * 2
+                         + ((row % (Device::height / 2)) * 2 + row / (Device::height / 2)) * Device::width + column] =
+                            channels[0][index];
+                }
+            }
+        }
+    }
+
+    /// rotate_deinterleave converts a Device::framerate / replicates stream of diamond patterns to a 60 fps YUV420
+    /// stream. Bit patterns are packed continuously (least significant bit first) and padded to a whole byte.
+    template <typename Device = lightcrafter_1440_hz>
+    inline void rotate_deinterleave(
+        frame_reader& reader,
+        frame_writer& writer,
+        bool bit_input,
+        std::size_t threads = 1,
+        instruction_set set = detect_instruction_set(),
+        std::size_t replicates = 1) {
+        if (bit_input && Device::bits_per_pattern != 1) {
+            throw std::logic_error("bit input requires one bit per pattern");
+        }
+        if (replicates == 0 || Device::patterns_per_frame % replicates != 0) {
+            throw std::logic_error("the number of replicates must divide the number of patterns per frame");
+        }
+        pack_groups<Device>(
+            reader,
+            writer,
+            (bit_input ? (diamond<Device>::pixels + 7) / 8 : diamond<Device>::pixels)
+                * (Device::patterns_per_frame / replicates),
+            threads,
+            [=](const uint8_t* bytes, uint8_t* frame) {
+                rotate_deinterleave_group<Device>(set, bit_input, bytes, frame, replicates);
+            });
+    }
+}
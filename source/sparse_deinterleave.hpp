@@ -0,0 +1,102 @@
+#pragma once
+
+#include "device.hpp"
+#include "io.hpp"
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// hummingbird bundles tools to create and play high framerate videos.
+namespace hummingbird {
+    /// insert_sparse_pixel sets or clears the mask bits of a pixel in a YUV420 frame.
+    /// masks contains one mask per channel (0 for the U and V planes, 1 and 2 for the even and odd Y bytes).
+    template <typename Device>
+    inline void insert_sparse_pixel(uint8_t* frame, std::size_t x, std::size_t y, const uint8_t* masks, bool on) {
+        const auto pixel = x + y * Device::width;
+        auto& blue = frame
+            [Device::pixels * 2 + ((y % (Device::height / 2)) * 2 + y / (Device::height / 2)) * Device::width + x];
+        if (on) {
+            frame[pixel * 2] |= masks[1];
+            frame[pixel * 2 + 1] |= masks[2];
+            blue |= masks[0];
+        } else {
+            frame[pixel * 2] &= ~masks[1];
+            frame[pixel * 2 + 1] &= ~masks[2];
+            blue &= ~masks[0];
+        }
+    }
+
+    /// sparse_deinterleave converts a Device::framerate / replicates stream of sparse frames to a 60 fps YUV420
+    /// stream. Each sparse frame is a little-endian uint32 count followed by count ON pixels, each encoded as
+    /// little-endian uint16 x and y coordinates. The other pixels are OFF.
+    /// Every output frame keeps the ON pixels it was last packed with, hence packing a group only clears these
+    /// pixels and sets the new ones: the cost scales with the number of ON pixels instead of the resolution.
+    template <typename Device = lightcrafter_1440_hz>
+    inline void sparse_deinterleave(frame_reader& reader, frame_writer& writer, std::size_t replicates = 1) {
+        if (replicates == 0 || Device::patterns_per_frame % replicates != 0) {
+            throw std::logic_error("the number of replicates must divide the number of patterns per frame");
+        }
+        const std::size_t frames_per_group = Device::patterns_per_frame / replicates;
+        struct channel_masks {
+            uint8_t masks[3];
+        };
+        std::vector<channel_masks> frames_masks(frames_per_group, channel_masks{{0, 0, 0}});
+        for (std::size_t pattern = 0; pattern < Device::patterns_per_frame; ++pattern) {
+            frames_masks[pattern / replicates].masks[Device::pattern_channel(pattern)] |=
+                Device::pattern_mask(pattern);
+        }
+        struct packed_frame {
+            std::vector<uint8_t> bytes;
+            std::vector<std::vector<uint32_t>> pixels;
+        };
+        std::vector<packed_frame> packed_frames(1 + writer.retained());
+        for (auto& packed_frame : packed_frames) {
+            packed_frame.bytes.resize(Device::frame_size, 0);
+            packed_frame.pixels.resize(frames_per_group);
+        }
+        const std::string frame_header("FRAME\n");
+        writer.write(Device::yuv4mpeg2_header(), nullptr, 0);
+        std::vector<uint8_t> buffer(4);
+        for (std::size_t index = 0;; ++index) {
+            auto& packed_frame = packed_frames[index % packed_frames.size()];
+            for (std::size_t frame_index = 0; frame_index < frames_per_group; ++frame_index) {
+                auto bytes = reader.read(buffer.data(), 4);
+                if (!bytes) {
+                    return;
+                }
+                const auto count = static_cast<std::size_t>(bytes[0]) | (static_cast<std::size_t>(bytes[1]) << 8)
+                                   | (static_cast<std::size_t>(bytes[2]) << 16)
+                                   | (static_cast<std::size_t>(bytes[3]) << 24);
+                if (buffer.size() < count * 4) {
+                    buffer.resize(count * 4);
+                }
+                bytes = reader.read(buffer.data(), count * 4);
+                if (!bytes) {
+                    return;
+                }
+                const auto& masks = frames_masks[frame_index].masks;
+                auto& pixels = packed_frame.pixels[frame_index];
+                for (const auto pixel : pixels) {
+                    insert_sparse_pixel<Device>(
+                        packed_frame.bytes.data(), pixel % Device::width, pixel / Device::width, masks, false);
+                }
+                pixels.clear();
+                for (std::size_t event = 0; event < count; ++event) {
+                    const std::size_t x = static_cast<std::size_t>(bytes[event * 4])
+                                          | (static_cast<std::size_t>(bytes[event * 4 + 1]) << 8);
+                    const std::size_t y = static_cast<std::size_t>(bytes[event * 4 + 2])
+                                          | (static_cast<std::size_t>(bytes[event * 4 + 3]) << 8);
+                    if (x >= Device::width || y >= Device::height) {
+                        throw std::runtime_error(
+                            std::string("the sparse pixel (") + std::to_string(x) + ", " + std::to_string(y)
+                            + ") is out of range");
+                    }
+                    insert_sparse_pixel<Device>(packed_frame.bytes.data(), x, y, masks, true);
+                    pixels.push_back(static_cast<uint32_t>(x + y * Device::width));
+                }
+            }
+            writer.write(frame_header, packed_frame.bytes.data(), packed_frame.bytes.size());
+        }
+    }
+}
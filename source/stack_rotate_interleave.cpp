@@ -1,27 +1,62 @@
 #include "../third_party/pontella/source/pontella.hpp"
-#include "deinterleave.hpp"
-#include <iostream>
+#include "rotate_deinterleave.hpp"
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <unistd.h>
 
 int main(int argc, char* argv[]) {
     return pontella::main(
         {
             "stack_rotate_interleave converts 343x342@1440Hz binary frames to a YUV4MPEG2 stream",
-            "    the app reads a stream of raw, row-major frames from stdin and writes to stdout",
-            "Syntax: ./generate [options]",
+            "    the app reads a stream of raw, row-major frames from stdin,",
+            "    or from the file given with the option 'input', and writes to stdout",
+            "    the frames are rotated to follow the diamond pixel arrangement of the DMD",
+            "Syntax: ./stack_rotate_interleave [options]",
             "Available options",
-            "    -g , --grey    switches the input mode to grey",
-            "                       without the flag, raw frames must be ⌈343 * 342 / 8⌉ = 14664 bytes long",
-            "                       the last 6 bits are not used",
-            "                       with the flag, raw frames must be 343 * 342 bytes long",
-            "                       and a value larger than 127 means ON",
-            "    -h, --help     shows this help message",
+            "    -g, --grey                           switches the input mode to grey",
+            "                                             without the flag, raw frames must be",
+            "                                             ⌈343 * 342 / 8⌉ = 14664 bytes long",
+            "                                             the last 6 bits are not used",
+            "                                             with the flag, raw frames must be 343 * 342 bytes long",
+            "                                             and a value larger than 127 means ON",
+            "    -i [path], --input [path]            reads the frames from a file instead of stdin",
+            "                                             the file is memory-mapped and read in place",
+            "    -t [threads], --threads [threads]    sets the number of packing threads",
+            "                                             defaults to the number of cores",
+            "    -h, --help                           shows this help message",
         },
         argc,
         argv,
         0,
-        {},
+        {
+            {"input", {"i"}},
+            {"threads", {"t"}},
+        },
         {{"grey", {"g"}}},
         [](pontella::command command) {
-            hummingbird::deinterleave(std::cin, std::cout, command.flags.find("grey") == command.flags.end());
+            std::size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+            {
+                const auto name_and_value = command.options.find("threads");
+                if (name_and_value != command.options.end()) {
+                    threads = std::stoull(name_and_value->second);
+                    if (threads == 0) {
+                        throw std::runtime_error("the number of threads must be larger than 0");
+                    }
+                }
+            }
+            std::unique_ptr<hummingbird::frame_reader> reader;
+            {
+                const auto name_and_value = command.options.find("input");
+                if (name_and_value != command.options.end()) {
+                    reader.reset(new hummingbird::mapped_frame_reader(name_and_value->second));
+                } else {
+                    reader.reset(new hummingbird::file_descriptor_frame_reader(STDIN_FILENO));
+                }
+            }
+            hummingbird::file_descriptor_frame_writer writer(
+                STDOUT_FILENO, hummingbird::lightcrafter_1440_hz::frame_size);
+            hummingbird::rotate_deinterleave(
+                *reader, writer, command.flags.find("grey") == command.flags.end(), threads);
         });
 }